@@ -6,42 +6,106 @@
  ============================================================================
  */
 
+// For posix_madvise
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200112L
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "dataset_hdf5.h"
 
+#include "disjoint_matrix.h"
+#include "types/dataset_layout_t.h"
+#include "types/dataset_map_t.h"
 #include "types/dataset_t.h"
+#include "types/dm_t.h"
+#include "types/io_stats_t.h"
 #include "types/oknok_t.h"
 #include "types/word_t.h"
+#include "utils/bit.h"
 
 #include "hdf5.h"
 
 #include <assert.h>
 #include <math.h>
+#include <omp.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/**
+ * Data read and written so far. The hdf5 library isn't thread-safe, so
+ * only one thread does it at a time, but the reads from a mapping may run
+ * in parallel and are added atomically
+ */
+static io_stats_t io_stats = { 0, 0.0, 0, 0.0 };
 
 oknok_t hdf5_open_dataset(const char* filename, const char* datasetname,
 						  dataset_hdf5_t* dataset)
 {
+	/**
+	 * The file is opened to write the disjoint matrix. The column dataset is
+	 * written in strided hyperslabs, one segment per attribute, that data
+	 * sieving would turn into read-modify-write cycles, so disable it.
+	 */
+	hid_t fapl_id = H5Pcreate(H5P_FILE_ACCESS);
+	assert(fapl_id != NOK);
+
+	H5Pset_sieve_buf_size(fapl_id, 0);
+
 	// Open the file
-	hid_t f_id = H5Fopen(filename, H5F_ACC_RDWR, H5P_DEFAULT);
+	hid_t f_id = H5Fopen(filename, H5F_ACC_RDWR, fapl_id);
 	assert(f_id != NOK);
 
+	H5Pclose(fapl_id);
+
 	// Open the dataset
 	hid_t dset_id = H5Dopen(f_id, datasetname, H5P_DEFAULT);
 	assert(dset_id != NOK);
 
 	dataset->file_id	= f_id;
 	dataset->dataset_id = dset_id;
+	dataset->tiles		= NULL;
+	dataset->dm			= NULL;
+	dataset->map		= NULL;
 	hdf5_get_dataset_dimensions(dset_id, dataset->dimensions);
 
 	return OK;
 }
 
+/**
+ * Creates a dataset access property list with a chunk cache of cache_size
+ * bytes, or room for two chunks of chunk_dimensions if it's 0
+ */
+static hid_t create_chunk_cache_dapl(const hsize_t chunk_dimensions[2],
+									 const hid_t datatype,
+									 const uint64_t cache_size)
+{
+	hid_t dapl_id = H5Pcreate(H5P_DATASET_ACCESS);
+	assert(dapl_id != NOK);
+
+	uint64_t n_bytes = cache_size;
+	if (n_bytes == 0)
+	{
+		n_bytes = 2 * chunk_dimensions[0] * chunk_dimensions[1]
+			* H5Tget_size(datatype);
+	}
+
+	// The chunks are mostly accessed once, so evict the fully used first
+	herr_t err = H5Pset_chunk_cache(dapl_id, CHUNK_CACHE_SLOTS, n_bytes, 1.0);
+	assert(err != NOK);
+
+	return dapl_id;
+}
+
 hid_t hdf5_create_dataset(const hid_t file_id, const char* name,
-						  const uint32_t n_lines, const uint32_t n_words,
-						  const hid_t datatype)
+						  const uint64_t n_lines, const uint64_t n_words,
+						  const hid_t datatype, const dataset_layout_t* layout)
 {
 	// Dataset dimensions
 	hsize_t dimensions[2] = { n_lines, n_words };
@@ -53,18 +117,238 @@ hid_t hdf5_create_dataset(const hid_t file_id, const char* name,
 	hid_t dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
 	assert(dcpl_id != NOK);
 
+	hid_t dapl_id = H5P_DEFAULT;
+
+	if (layout != NULL && layout->chunk_dimensions[0] > 0 && n_lines > 0
+		&& n_words > 0)
+	{
+		// The chunks can't be larger than the dataset
+		hsize_t chunk_dimensions[2];
+		for (uint8_t d = 0; d < 2; d++)
+		{
+			chunk_dimensions[d] = layout->chunk_dimensions[d];
+			if (chunk_dimensions[d] == 0 || chunk_dimensions[d] > dimensions[d])
+			{
+				chunk_dimensions[d] = dimensions[d];
+			}
+		}
+
+		herr_t err = H5Pset_chunk(dcpl_id, 2, chunk_dimensions);
+		assert(err != NOK);
+
+		if (layout->deflate_level > 0)
+		{
+			// Shuffling groups the bytes by significance, which compresses
+			// better
+			err = H5Pset_shuffle(dcpl_id);
+			assert(err != NOK);
+
+			err = H5Pset_deflate(dcpl_id, layout->deflate_level);
+			assert(err != NOK);
+		}
+
+		dapl_id = create_chunk_cache_dapl(chunk_dimensions, datatype,
+										  layout->chunk_cache_size);
+	}
+
 	// Create the dataset
 	hid_t dset_id = H5Dcreate(file_id, name, datatype, filespace_id,
-							  H5P_DEFAULT, dcpl_id, H5P_DEFAULT);
+							  H5P_DEFAULT, dcpl_id, dapl_id);
 	assert(dset_id != NOK);
 
 	// Close resources
+	if (dapl_id != H5P_DEFAULT)
+	{
+		H5Pclose(dapl_id);
+	}
+	H5Pclose(dcpl_id);
+	H5Sclose(filespace_id);
+
+	return dset_id;
+}
+
+hid_t hdf5_create_growing_dataset(const hid_t file_id, const char* name,
+								  const uint64_t n_words,
+								  const uint64_t chunk_lines,
+								  const hid_t datatype)
+{
+	// It starts empty and only the number of lines can grow
+	hsize_t dimensions[2]	  = { 0, n_words };
+	hsize_t max_dimensions[2] = { H5S_UNLIMITED, n_words };
+
+	hid_t filespace_id = H5Screate_simple(2, dimensions, max_dimensions);
+	assert(filespace_id != NOK);
+
+	// Growing datasets have to be chunked
+	hid_t dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
+	assert(dcpl_id != NOK);
+
+	hsize_t chunk_dimensions[2] = { chunk_lines, n_words };
+
+	herr_t err = H5Pset_chunk(dcpl_id, 2, chunk_dimensions);
+	assert(err != NOK);
+
+	hid_t dset_id = H5Dcreate(file_id, name, datatype, filespace_id,
+							  H5P_DEFAULT, dcpl_id, H5P_DEFAULT);
+	assert(dset_id != NOK);
+
 	H5Pclose(dcpl_id);
 	H5Sclose(filespace_id);
 
 	return dset_id;
 }
 
+hid_t hdf5_open_matrix_dataset(const hid_t file_id, const char* name,
+							   const uint64_t chunk_cache_size)
+{
+	hid_t dset_id = H5Dopen(file_id, name, H5P_DEFAULT);
+	assert(dset_id != NOK);
+
+	hid_t dcpl_id = H5Dget_create_plist(dset_id);
+	assert(dcpl_id != NOK);
+
+	if (H5Pget_layout(dcpl_id) == H5D_CHUNKED)
+	{
+		hsize_t chunk_dimensions[2] = { 0, 0 };
+		H5Pget_chunk(dcpl_id, 2, chunk_dimensions);
+
+		hid_t datatype = H5Dget_type(dset_id);
+
+		hid_t dapl_id = create_chunk_cache_dapl(chunk_dimensions, datatype,
+												chunk_cache_size);
+
+		// The chunk cache is set when the dataset is opened
+		H5Dclose(dset_id);
+		dset_id = H5Dopen(file_id, name, dapl_id);
+		assert(dset_id != NOK);
+
+		H5Pclose(dapl_id);
+		H5Tclose(datatype);
+	}
+
+	H5Pclose(dcpl_id);
+
+	return dset_id;
+}
+
+/**
+ * Maps the data of a contiguous dataset of native words into memory.
+ * Returns NULL if it can't be read straight from the file: it's chunked,
+ * external, not allocated yet, of another datatype or the file isn't
+ * accessed through the default driver
+ */
+static dataset_map_t* map_dataset_data(const hid_t dataset_id)
+{
+	hid_t dcpl_id		 = H5Dget_create_plist(dataset_id);
+	H5D_layout_t layout	 = H5Pget_layout(dcpl_id);
+	int n_external_files = H5Pget_external_count(dcpl_id);
+	H5Pclose(dcpl_id);
+
+	hid_t datatype = H5Dget_type(dataset_id);
+	htri_t is_word = H5Tequal(datatype, H5T_NATIVE_UINT64);
+	H5Tclose(datatype);
+
+	if (layout != H5D_CONTIGUOUS || n_external_files > 0 || is_word <= 0)
+	{
+		return NULL;
+	}
+
+	haddr_t address = H5Dget_offset(dataset_id);
+	hsize_t size	= H5Dget_storage_size(dataset_id);
+	if (address == HADDR_UNDEF || size == 0)
+	{
+		return NULL;
+	}
+
+	hid_t file_id = H5Iget_file_id(dataset_id);
+	hid_t fapl_id = H5Fget_access_plist(file_id);
+
+	int* fd = NULL;
+	if (H5Pget_driver(fapl_id) == H5FD_SEC2)
+	{
+		// What was written through hdf5 must be in the file
+		unsigned int intent = 0;
+		H5Fget_intent(file_id, &intent);
+		if (intent & H5F_ACC_RDWR)
+		{
+			H5Fflush(file_id, H5F_SCOPE_LOCAL);
+		}
+
+		H5Fget_vfd_handle(file_id, fapl_id, (void**) &fd);
+	}
+
+	H5Pclose(fapl_id);
+	H5Fclose(file_id);
+
+	if (fd == NULL)
+	{
+		return NULL;
+	}
+
+	// The mapping must start at a page boundary
+	uint64_t page_size = sysconf(_SC_PAGESIZE);
+	uint64_t start	   = address - address % page_size;
+
+	dataset_map_t* map = (dataset_map_t*) malloc(sizeof(dataset_map_t));
+	assert(map != NULL);
+
+	map->length	 = address - start + size;
+	map->address = mmap(NULL, map->length, PROT_READ, MAP_SHARED, *fd,
+						(off_t) start);
+	if (map->address == MAP_FAILED)
+	{
+		free(map);
+		return NULL;
+	}
+
+	map->data = (const uint8_t*) map->address + (address - start);
+
+	return map;
+}
+
+/**
+ * Unmaps and frees the mapping
+ */
+static void unmap_dataset_data(dataset_map_t* map)
+{
+	munmap(map->address, map->length);
+	free(map);
+}
+
+void hdf5_map_dataset(dataset_hdf5_t* dataset, const bool sequential)
+{
+	dataset->map = map_dataset_data(dataset->dataset_id);
+
+	hdf5_advise_dataset(dataset, sequential);
+}
+
+void hdf5_advise_dataset(const dataset_hdf5_t* dataset, const bool sequential)
+{
+	if (dataset->map == NULL)
+	{
+		return;
+	}
+
+	posix_madvise(dataset->map->address, dataset->map->length,
+				  sequential ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_RANDOM);
+}
+
+void hdf5_unmap_dataset(dataset_hdf5_t* dataset)
+{
+	if (dataset->map == NULL)
+	{
+		return;
+	}
+
+	unmap_dataset_data(dataset->map);
+	dataset->map = NULL;
+}
+
+void hdf5_get_io_stats(io_stats_t* stats)
+{
+	*stats = io_stats;
+}
+
 bool hdf5_dataset_exists(const hid_t file_id, const char* datasetname)
 {
 	return (H5Lexists(file_id, datasetname, H5P_DEFAULT) > 0);
@@ -184,6 +468,29 @@ oknok_t hdf5_read_attribute(hid_t dataset_id, const char* attribute,
 
 oknok_t hdf5_read_dataset_data(hid_t dataset_id, word_t* data)
 {
+	dataset_map_t* map = map_dataset_data(dataset_id);
+	if (map != NULL)
+	{
+		// It's copied once, in order, straight from the file
+		posix_madvise(map->address, map->length, POSIX_MADV_SEQUENTIAL);
+
+		hsize_t dimensions[2] = { 0, 0 };
+		hdf5_get_dataset_dimensions(dataset_id, dimensions);
+
+		uint64_t n_bytes = dimensions[0] * dimensions[1] * sizeof(word_t);
+
+		double start = omp_get_wtime();
+
+		memcpy(data, map->data, n_bytes);
+
+		io_stats.read_time += omp_get_wtime() - start;
+		io_stats.bytes_read += n_bytes;
+
+		unmap_dataset_data(map);
+
+		return OK;
+	}
+
 	// Fill dataset from hdf5 file
 	herr_t status = H5Dread(dataset_id, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL,
 							H5P_DEFAULT, data);
@@ -199,41 +506,296 @@ oknok_t hdf5_read_dataset_data(hid_t dataset_id, word_t* data)
 	return OK;
 }
 
-oknok_t hdf5_read_line(const dataset_hdf5_t* dataset, const uint32_t index,
-					   const uint32_t n_words, word_t* line)
+/**
+ * Reads the columns of the tiles from first_line and transposes them into
+ * the lines
+ */
+static oknok_t read_tiles(const dataset_hdf5_t* dataset,
+						  const uint64_t first_line)
+{
+	line_tiles_t* tiles	  = dataset->tiles;
+	uint32_t n_attributes = dataset->dimensions[0];
+
+	uint64_t first_word		= first_line / WORD_BITS;
+	uint64_t n_column_words = dataset->dimensions[1] - first_word;
+	if (n_column_words > tiles->n_column_words)
+	{
+		n_column_words = tiles->n_column_words;
+	}
+
+	hsize_t offset[2] = { 0, first_word };
+	hsize_t count[2]  = { n_attributes, n_column_words };
+
+	oknok_t ret = hdf5_read_words(dataset, offset, count, tiles->columns);
+	if (ret != OK)
+	{
+		tiles->n_lines = 0;
+		return ret;
+	}
+
+	word_t tile[WORD_BITS];
+
+	for (uint64_t t = 0; t < n_column_words; t++)
+	{
+		word_t* lines = tiles->lines + t * WORD_BITS * tiles->n_words;
+
+		for (uint32_t w = 0; w < tiles->n_words; w++)
+		{
+			// A line of the tile for each attribute of the word
+			memset(tile, 0, sizeof(tile));
+			for (uint32_t a = w * WORD_BITS;
+				 a < n_attributes && a < (w + 1) * WORD_BITS; a++)
+			{
+				tile[a % WORD_BITS] = tiles->columns[a * n_column_words + t];
+			}
+
+			transpose64(tile);
+
+			for (uint8_t l = 0; l < WORD_BITS; l++)
+			{
+				lines[l * tiles->n_words + w] = tile[l];
+			}
+		}
+	}
+
+	tiles->first_line = first_word * WORD_BITS;
+	tiles->n_lines	  = n_column_words * WORD_BITS;
+
+	return OK;
+}
+
+/**
+ * hdf5_read_lines for a column dataset.
+ * The lines come from the tiles last read, which are replaced by the ones
+ * holding the next line when needed
+ */
+static oknok_t read_lines_from_tiles(const dataset_hdf5_t* dataset,
+									 const uint64_t index,
+									 const uint32_t n_words,
+									 const uint64_t n_lines, word_t* lines)
+{
+	line_tiles_t* tiles = dataset->tiles;
+	assert(n_words == tiles->n_words);
+
+	uint64_t tile_lines = tiles->n_column_words * WORD_BITS;
+
+	uint64_t line = index;
+	while (line < index + n_lines)
+	{
+		if (line < tiles->first_line
+			|| line >= tiles->first_line + tiles->n_lines)
+		{
+			oknok_t ret = read_tiles(dataset, line / tile_lines * tile_lines);
+			if (ret != OK)
+			{
+				return ret;
+			}
+		}
+
+		uint64_t n = tiles->first_line + tiles->n_lines - line;
+		if (n > index + n_lines - line)
+		{
+			n = index + n_lines - line;
+		}
+
+		memcpy(lines + (line - index) * n_words,
+			   tiles->lines + (line - tiles->first_line) * n_words,
+			   n * n_words * sizeof(word_t));
+
+		line += n;
+	}
+
+	return OK;
+}
+
+void hdf5_init_line_tiles(const dataset_hdf5_t* column_dataset,
+						  dataset_hdf5_t* line_dataset)
+{
+	*line_dataset = *column_dataset;
+
+	line_tiles_t* tiles = (line_tiles_t*) malloc(sizeof(line_tiles_t));
+	assert(tiles != NULL);
+
+	uint32_t n_attributes = column_dataset->dimensions[0];
+
+	// Read whole chunks at a time, if the columns are chunked
+	tiles->n_column_words = LINE_TILES_READ_WORDS;
+
+	hid_t dcpl_id = H5Dget_create_plist(column_dataset->dataset_id);
+	if (H5Pget_layout(dcpl_id) == H5D_CHUNKED)
+	{
+		hsize_t chunk_dimensions[2] = { 0, 0 };
+		H5Pget_chunk(dcpl_id, 2, chunk_dimensions);
+
+		tiles->n_column_words = chunk_dimensions[1];
+	}
+	H5Pclose(dcpl_id);
+
+	tiles->n_words = n_attributes / WORD_BITS + (n_attributes % WORD_BITS != 0);
+
+	// Nothing read yet
+	tiles->first_line = 0;
+	tiles->n_lines	  = 0;
+
+	tiles->columns = (word_t*) malloc((uint64_t) n_attributes
+									  * tiles->n_column_words * sizeof(word_t));
+	assert(tiles->columns != NULL);
+
+	tiles->lines = (word_t*) malloc(tiles->n_column_words * WORD_BITS
+									* tiles->n_words * sizeof(word_t));
+	assert(tiles->lines != NULL);
+
+	line_dataset->tiles = tiles;
+}
+
+void hdf5_free_line_tiles(dataset_hdf5_t* line_dataset)
 {
-	return hdf5_read_lines(dataset, index, n_words, 1, line);
+	if (line_dataset->tiles == NULL)
+	{
+		return;
+	}
+
+	free(line_dataset->tiles->columns);
+	free(line_dataset->tiles->lines);
+	free(line_dataset->tiles);
+
+	line_dataset->tiles = NULL;
 }
 
-oknok_t hdf5_read_lines(const dataset_hdf5_t* dataset, const uint32_t index,
-						const uint32_t n_words, const uint32_t n_lines,
+oknok_t hdf5_read_lines(const dataset_hdf5_t* dataset, const uint64_t index,
+						const uint32_t n_words, const uint64_t n_lines,
 						word_t* lines)
 {
+	if (dataset->tiles != NULL)
+	{
+		return read_lines_from_tiles(dataset, index, n_words, n_lines, lines);
+	}
+
+	if (dataset->dm != NULL)
+	{
+		return generate_dm_lines(dataset->dm, n_words, index, n_lines, lines);
+	}
+
 	// Setup offset
 	hsize_t offset[2] = { index, 0 };
 
 	// Setup count
 	hsize_t count[2] = { n_lines, n_words };
 
-	const hsize_t dimensions[2] = { n_lines, n_words };
+	return hdf5_read_words(dataset, offset, count, lines);
+}
+
+oknok_t hdf5_read_words(const dataset_hdf5_t* dataset, const hsize_t offset[2],
+						const hsize_t count[2], word_t* buffer)
+{
+	if (dataset->map == NULL)
+	{
+		return hdf5_read_from_dataset(dataset->dataset_id, offset, count,
+									  H5T_NATIVE_UINT64, buffer);
+	}
+
+	uint64_t row_bytes = dataset->dimensions[1] * sizeof(word_t);
+	uint64_t n_bytes   = count[1] * sizeof(word_t);
+
+	const uint8_t* data = dataset->map->data + offset[0] * row_bytes
+		+ offset[1] * sizeof(word_t);
+
+	double start = omp_get_wtime();
+
+	if (n_bytes == row_bytes)
+	{
+		// Whole lines are in one piece
+		memcpy(buffer, data, count[0] * n_bytes);
+	}
+	else
+	{
+		for (uint64_t i = 0; i < count[0]; i++)
+		{
+			memcpy(buffer + i * count[1], data + i * row_bytes, n_bytes);
+		}
+	}
+
+	double elapsed = omp_get_wtime() - start;
+
+	// Reads from the mapping aren't serialized like the hdf5 ones
+#pragma omp atomic
+	io_stats.read_time += elapsed;
+#pragma omp atomic
+	io_stats.bytes_read += count[0] * n_bytes;
+
+	return OK;
+}
+
+const word_t* hdf5_get_mapped_words(const dataset_hdf5_t* dataset,
+									const hsize_t offset[2],
+									const hsize_t count[2])
+{
+	// The tiles share the mapping of the columns, but not its layout
+	if (dataset->map == NULL || dataset->tiles != NULL)
+	{
+		return NULL;
+	}
+
+	// Only whole lines, or a part of one, are contiguous in the file
+	if (count[0] > 1 && count[1] != dataset->dimensions[1])
+	{
+		return NULL;
+	}
+
+	const uint8_t* data = dataset->map->data
+		+ (offset[0] * dataset->dimensions[1] + offset[1]) * sizeof(word_t);
+
+	if ((uintptr_t) data % sizeof(word_t) != 0)
+	{
+		return NULL;
+	}
+
+#pragma omp atomic
+	io_stats.bytes_read += count[0] * count[1] * sizeof(word_t);
+
+	return (const word_t*) data;
+}
+
+oknok_t hdf5_read_from_dataset(const hid_t dset_id, const hsize_t offset[2],
+							   const hsize_t count[2], const hid_t datatype,
+							   void* buffer)
+{
+	/**
+	 * If we don't have anything to read, return here
+	 */
+	if (count[0] == 0 || count[1] == 0)
+	{
+		return OK;
+	}
 
 	// Create a memory dataspace to indicate the size of our buffer/chunk
-	hid_t memspace_id = H5Screate_simple(2, dimensions, NULL);
+	hid_t memspace_id = H5Screate_simple(2, count, NULL);
 
-	// Setup line dataspace
-	hid_t dataspace_id = H5Dget_space(dataset->dataset_id);
+	// Setup dataspace
+	hid_t dataspace_id = H5Dget_space(dset_id);
 
 	// Select hyperslab on file dataset
 	H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, NULL, count,
 						NULL);
 
-	// Read line from dataset
-	H5Dread(dataset->dataset_id, H5T_NATIVE_UINT64, memspace_id, dataspace_id,
-			H5P_DEFAULT, lines);
+	double start = omp_get_wtime();
+
+	// Read data from dataset
+	herr_t err = H5Dread(dset_id, datatype, memspace_id, dataspace_id,
+						 H5P_DEFAULT, buffer);
+
+	io_stats.read_time += omp_get_wtime() - start;
+	io_stats.bytes_read += count[0] * count[1] * H5Tget_size(datatype);
 
 	H5Sclose(dataspace_id);
 	H5Sclose(memspace_id);
 
+	if (err < 0)
+	{
+		fprintf(stderr, "Error reading from dataset\n");
+		return NOK;
+	}
+
 	return OK;
 }
 
@@ -294,8 +856,8 @@ void hdf5_close_dataset(dataset_hdf5_t* dataset)
 	H5Fclose(dataset->file_id);
 }
 
-oknok_t hdf5_write_n_lines(const hid_t dset_id, const uint32_t start,
-						   const uint32_t n_lines, const uint32_t n_words,
+oknok_t hdf5_write_n_lines(const hid_t dset_id, const uint64_t start,
+						   const uint64_t n_lines, const uint64_t n_words,
 						   const hid_t datatype, const void* buffer)
 {
 	/**
@@ -313,6 +875,29 @@ oknok_t hdf5_write_n_lines(const hid_t dset_id, const uint32_t start,
 	return hdf5_write_to_dataset(dset_id, offset, count, datatype, buffer);
 }
 
+oknok_t hdf5_append_to_dataset(const hid_t dset_id, const uint64_t n_lines,
+							   const uint64_t n_words, const hid_t datatype,
+							   const void* buffer)
+{
+	if (n_lines == 0)
+	{
+		return OK;
+	}
+
+	hsize_t dimensions[2];
+	hdf5_get_dataset_dimensions(dset_id, dimensions);
+
+	hsize_t offset[2] = { dimensions[0], 0 };
+	hsize_t count[2]  = { n_lines, n_words };
+
+	dimensions[0] += n_lines;
+
+	herr_t err = H5Dset_extent(dset_id, dimensions);
+	assert(err != NOK);
+
+	return hdf5_write_to_dataset(dset_id, offset, count, datatype, buffer);
+}
+
 oknok_t hdf5_write_to_dataset(const hid_t dset_id, const hsize_t offset[2],
 							  const hsize_t count[2], const hid_t datatype,
 							  const void* buffer)
@@ -345,11 +930,16 @@ oknok_t hdf5_write_to_dataset(const hid_t dset_id, const hsize_t offset[2],
 	hid_t memspace_id = H5Screate_simple(2, count, NULL);
 	assert(memspace_id != NOK);
 
+	double start = omp_get_wtime();
+
 	// Write buffer to dataset
 	err = H5Dwrite(dset_id, datatype, memspace_id, filespace_id, H5P_DEFAULT,
 				   buffer);
 	assert(err != NOK);
 
+	io_stats.write_time += omp_get_wtime() - start;
+	io_stats.bytes_written += count[0] * count[1] * H5Tget_size(datatype);
+
 	H5Sclose(memspace_id);
 	H5Sclose(filespace_id);
 
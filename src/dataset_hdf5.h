@@ -10,7 +10,9 @@
 #define HDF5_DATASET_H
 
 #include "types/dataset_hdf5_t.h"
+#include "types/dataset_layout_t.h"
 #include "types/dataset_t.h"
+#include "types/io_stats_t.h"
 #include "types/oknok_t.h"
 
 #include "hdf5.h"
@@ -40,6 +42,24 @@
  */
 #define DM_ATTRIBUTE_TOTALS "/ATTRIBUTE_TOTALS"
 
+/**
+ * The name of the datasets that store the observations that generate the
+ * disjoint matrix lines, deduplicated and with their jnsqs, grouped by
+ * class, and the number of observations of each class
+ */
+#define DM_OBSERVATIONS			  "/OBSERVATIONS"
+#define DM_OBSERVATIONS_PER_CLASS "/OBSERVATIONS_PER_CLASS"
+
+/**
+ * The name of the group that stores the disjoint matrix columns as the
+ * lines they cover, and of its datasets
+ */
+#define DM_SPARSE_COLUMNS	  "/SPARSE_COLUMNS"
+#define DM_SPARSE_INDEX		  "/SPARSE_COLUMNS/INDEX"
+#define DM_SPARSE_CONTAINERS  "/SPARSE_COLUMNS/CONTAINERS"
+#define DM_SPARSE_ARRAY_LINES "/SPARSE_COLUMNS/ARRAY_LINES"
+#define DM_SPARSE_BITMAPS	  "/SPARSE_COLUMNS/BITMAPS"
+
 /**
  * Attribute for number of classes
  */
@@ -61,17 +81,90 @@
 #define N_MATRIX_LINES_ATTR "n_matrix_lines"
 
 /**
- * Opens the file and dataset indicated
+ * Attribute for the tile size of the blocked line order of the disjoint
+ * matrix, 0 if the lines follow the order of the observations
+ */
+#define LINE_ORDER_TILE_ATTR "line_order_tile"
+
+/**
+ * Number of words of each column read at a time when reading lines from
+ * the tiles of a contiguous column dataset. A chunked one is read a chunk
+ * at a time
+ */
+#define LINE_TILES_READ_WORDS 64
+
+/**
+ * Number of slots of the chunk caches, a prime well above the number of
+ * chunks they usually hold
+ */
+#define CHUNK_CACHE_SLOTS 12421
+
+/**
+ * Opens the file and dataset indicated, for writing the disjoint matrix
  */
 oknok_t hdf5_open_dataset(const char* filename, const char* datasetname,
 						  dataset_hdf5_t* dataset);
 
 /**
- * Creates a new dataset in the indicated file
+ * Creates a new dataset in the indicated file.
+ * If layout is NULL or has no chunk dimensions the dataset is contiguous,
+ * otherwise it's chunked and possibly compressed as layout says
  */
 hid_t hdf5_create_dataset(const hid_t file_id, const char* name,
-						  const uint32_t n_lines, const uint32_t n_words,
-						  const hid_t datatype);
+						  const uint64_t n_lines, const uint64_t n_words,
+						  const hid_t datatype, const dataset_layout_t* layout);
+
+/**
+ * Creates a new empty dataset of n_words words per line that grows as lines
+ * are appended to it, stored in chunks of chunk_lines lines
+ */
+hid_t hdf5_create_growing_dataset(const hid_t file_id, const char* name,
+								  const uint64_t n_words,
+								  const uint64_t chunk_lines,
+								  const hid_t datatype);
+
+/**
+ * Opens a dataset of the disjoint matrix for reading. If it's chunked, its
+ * chunk cache has chunk_cache_size bytes, or room for two chunks if 0
+ */
+hid_t hdf5_open_matrix_dataset(const hid_t file_id, const char* name,
+							   const uint64_t chunk_cache_size);
+
+/**
+ * Sets line_dataset up to read the lines of the disjoint matrix from the
+ * tiles of column_dataset
+ */
+void hdf5_init_line_tiles(const dataset_hdf5_t* column_dataset,
+						  dataset_hdf5_t* line_dataset);
+
+/**
+ * Frees the tiles of line_dataset, if it has them
+ */
+void hdf5_free_line_tiles(dataset_hdf5_t* line_dataset);
+
+/**
+ * Maps the dataset into memory if it's contiguous, allocated and of native
+ * words, in a file accessed through the default driver. Otherwise it's
+ * still read with H5Dread.
+ * The kernel is told it will be read sequentially or at random
+ */
+void hdf5_map_dataset(dataset_hdf5_t* dataset, const bool sequential);
+
+/**
+ * Tells the kernel the mapped dataset will now be read sequentially or at
+ * random. Nothing is done if it isn't mapped
+ */
+void hdf5_advise_dataset(const dataset_hdf5_t* dataset, const bool sequential);
+
+/**
+ * Unmaps the dataset, if it's mapped
+ */
+void hdf5_unmap_dataset(dataset_hdf5_t* dataset);
+
+/**
+ * Returns the data read from and written to the datasets so far
+ */
+void hdf5_get_io_stats(io_stats_t* stats);
 
 /**
  * Checks if dataset is present in file_id
@@ -95,22 +188,47 @@ oknok_t hdf5_read_attribute(hid_t dataset_id, const char* attribute,
 							hid_t datatype, void* value);
 
 /**
- * Reads the entire dataset data from the hdf5 file
+ * Reads the entire dataset data from the hdf5 file.
+ * If it's contiguous it's copied from a temporary mapping of the file
  */
 oknok_t hdf5_read_dataset_data(hid_t dataset_id, word_t* data);
 
 /**
- * Retrieves a line from the dataset
+ * Reads n lines from the dataset.
+ * If the dataset has tiles, the tiles of WORD_BITS lines by WORD_BITS
+ * attributes of the column dataset are read and transposed into the lines.
+ * Their bits past the last attribute are 0.
+ * If the dataset has a disjoint matrix, the lines are generated from its
+ * observations
  */
-oknok_t hdf5_read_line(const dataset_hdf5_t* dataset, const uint32_t index,
-					   const uint32_t n_words, word_t* line);
+oknok_t hdf5_read_lines(const dataset_hdf5_t* dataset, const uint64_t index,
+						const uint32_t n_words, const uint64_t n_lines,
+						word_t* lines);
 
 /**
- * Reads n lines from the dataset
+ * Reads count words from offset of a dataset of words, from its mapping if
+ * it's mapped
  */
-oknok_t hdf5_read_lines(const dataset_hdf5_t* dataset, const uint32_t index,
-						const uint32_t n_words, const uint32_t n_lines,
-						word_t* lines);
+oknok_t hdf5_read_words(const dataset_hdf5_t* dataset, const hsize_t offset[2],
+						const hsize_t count[2], word_t* buffer);
+
+/**
+ * Returns the count words from offset of a mapped dataset of words, inside
+ * its mapping, without copying them.
+ * Returns NULL if they have to be read with hdf5_read_words: the dataset
+ * isn't mapped, they aren't contiguous or aren't aligned to a word
+ */
+const word_t* hdf5_get_mapped_words(const dataset_hdf5_t* dataset,
+									const hsize_t offset[2],
+									const hsize_t count[2]);
+
+/**
+ * Reads data from a dataset
+ */
+oknok_t hdf5_read_from_dataset(const hid_t dset_id, const hsize_t offset[2],
+							   const hsize_t count[2], const hid_t datatype,
+							   void* buffer);
+
 /**
  * Writes an attribute to the dataset
  */
@@ -130,10 +248,18 @@ void hdf5_close_dataset(dataset_hdf5_t* dataset);
 /**
  * Writes n_lines_out to the dataset
  */
-oknok_t hdf5_write_n_lines(const hid_t dset_id, const uint32_t start,
-						   const uint32_t n_lines, const uint32_t n_words,
+oknok_t hdf5_write_n_lines(const hid_t dset_id, const uint64_t start,
+						   const uint64_t n_lines, const uint64_t n_words,
 						   const hid_t datatype, const void* buffer);
 
+/**
+ * Appends n_lines lines to the end of a dataset created by
+ * hdf5_create_growing_dataset
+ */
+oknok_t hdf5_append_to_dataset(const hid_t dset_id, const uint64_t n_lines,
+							   const uint64_t n_words, const hid_t datatype,
+							   const void* buffer);
+
 /**
  * Writes data to a dataset
  */
@@ -9,24 +9,30 @@
 #include "disjoint_matrix.h"
 
 #include "dataset_hdf5.h"
+#include "types/bit_counters_t.h"
 #include "types/dataset_hdf5_t.h"
+#include "types/dataset_layout_t.h"
 #include "types/dataset_t.h"
 #include "types/dm_t.h"
 #include "types/oknok_t.h"
+#include "types/steps_t.h"
 #include "types/word_t.h"
 #include "utils/bit.h"
+#include "utils/bit_counters.h"
 #include "utils/timing.h"
 
 #include "hdf5.h"
 
 #include <assert.h>
+#include <omp.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-uint32_t get_dm_n_lines(const dataset_t* dataset)
+uint64_t get_dm_n_lines(const dataset_t* dataset)
 {
-	uint32_t n = 0;
+	uint64_t n = 0;
 
 	uint32_t n_classes	  = dataset->n_classes;
 	uint32_t* n_class_obs = dataset->n_observations_per_class;
@@ -35,32 +41,16 @@ uint32_t get_dm_n_lines(const dataset_t* dataset)
 	{
 		for (uint32_t j = i + 1; j < n_classes; j++)
 		{
-			n += n_class_obs[i] * n_class_obs[j];
+			n += (uint64_t) n_class_obs[i] * n_class_obs[j];
 		}
 	}
 
 	return n;
 }
 
-oknok_t generate_dm_column(const dm_t* dm, const int column, word_t* buffer)
-{
-	// Current buffer line
-	word_t* bl = buffer;
-
-	for (uint32_t cl = 0; cl < dm->n_matrix_lines; cl++)
-	{
-		word_t* la = dm->steps[cl].lineA;
-		word_t* lb = dm->steps[cl].lineB;
-
-		(*bl) = la[column] ^ lb[column];
-		bl++;
-	}
-
-	return OK;
-}
-
 herr_t write_dm_attributes(const hid_t dataset_id, const uint32_t n_attributes,
-						   const uint32_t n_matrix_lines)
+						   const uint64_t n_matrix_lines,
+						   const uint32_t tile_size)
 {
 	herr_t ret = 0;
 
@@ -71,266 +61,937 @@ herr_t write_dm_attributes(const hid_t dataset_id, const uint32_t n_attributes,
 		return ret;
 	}
 
-	ret = hdf5_write_attribute(dataset_id, N_MATRIX_LINES_ATTR, H5T_NATIVE_UINT,
-							   &n_matrix_lines);
+	ret = hdf5_write_attribute(dataset_id, N_MATRIX_LINES_ATTR,
+							   H5T_NATIVE_UINT64, &n_matrix_lines);
+	if (ret < 0)
+	{
+		return ret;
+	}
+
+	ret = hdf5_write_attribute(dataset_id, LINE_ORDER_TILE_ATTR,
+							   H5T_NATIVE_UINT, &tile_size);
 
 	return ret;
 }
 
-oknok_t generate_steps(const dataset_t* dataset, dm_t* dm)
+uint32_t get_dm_tile_size(const uint32_t n_words)
 {
+	uint32_t tile_size = DM_TILE_CACHE_SIZE / (2 * n_words * sizeof(word_t));
 
-	uint32_t nc	   = dataset->n_classes;
-	uint32_t nobs  = dataset->n_observations;
-	word_t** opc   = dataset->observations_per_class;
-	uint32_t* nopc = dataset->n_observations_per_class;
+	return tile_size > 0 ? tile_size : 1;
+}
 
-	// TODO: I think we can optimize the order of the lines
-	// to optimize cache usage and get faster results
-	// when calculating the attributes totals
+oknok_t init_dm_steps(const dataset_t* dataset, const uint32_t tile_size,
+					  dm_t* dm)
+{
+	dm->n_classes				 = dataset->n_classes;
+	dm->n_observations			 = dataset->n_observations;
+	dm->n_observations_per_class = dataset->n_observations_per_class;
+	dm->observations_per_class	 = dataset->observations_per_class;
+	dm->tile_size				 = tile_size;
 
-	uint32_t cs = 0;
+	return OK;
+}
 
-	// TODO: is there a better way?
+/**
+ * find_next_step for the blocked line order
+ */
+static void find_next_blocked_step(const dm_t* dm, steps_t* step)
+{
+	const uint32_t* nopc = dm->n_observations_per_class;
+	uint32_t tile_size	 = dm->tile_size;
 
-	for (uint32_t ca = 0; ca < nc - 1; ca++)
+	/**
+	 * The lines are generated in this order:
+	 * for each class a
+	 *   for each class b after class a
+	 *     for each tile of observations of class a
+	 *       for each tile of observations of class b
+	 *         for each observation of class a in the tile
+	 *           for each observation of class b in the tile
+	 */
+	while (step->class_a + 1 < dm->n_classes)
 	{
-		for (uint32_t ia = 0; ia < nopc[ca]; ia++)
+		if (step->class_b >= dm->n_classes)
 		{
-			for (uint32_t cb = ca + 1; cb < nc; cb++)
-			{
-				for (uint32_t ib = 0; ib < nopc[cb]; ib++)
-				{
-					// Generate next step
-					word_t** bla = opc + ca * nobs;
-					word_t** blb = opc + cb * nobs;
+			// Next class a
+			step->class_a++;
+			step->class_b = step->class_a + 1;
+			step->tile_a  = 0;
+			step->tile_b  = 0;
+			step->index_a = 0;
+			step->index_b = 0;
+			continue;
+		}
 
-					dm->steps[cs].lineA = *(bla + ia);
-					dm->steps[cs].lineB = *(blb + ib);
-					cs++;
-				}
-			}
+		uint32_t n_a = nopc[step->class_a];
+		uint32_t n_b = nopc[step->class_b];
+
+		if (step->tile_a >= n_a || n_b == 0)
+		{
+			// Next class b
+			step->class_b++;
+			step->tile_a  = 0;
+			step->tile_b  = 0;
+			step->index_a = 0;
+			step->index_b = 0;
+			continue;
+		}
+
+		if (step->tile_b >= n_b)
+		{
+			// Next tile of class a
+			step->tile_a += tile_size;
+			step->tile_b  = 0;
+			step->index_a = step->tile_a;
+			step->index_b = 0;
+			continue;
+		}
+
+		uint32_t end_a = n_a - step->tile_a < tile_size
+			? n_a
+			: step->tile_a + tile_size;
+		uint32_t end_b = n_b - step->tile_b < tile_size
+			? n_b
+			: step->tile_b + tile_size;
+
+		if (step->index_a >= end_a)
+		{
+			// Next tile of class b
+			step->tile_b += tile_size;
+			step->index_a = step->tile_a;
+			step->index_b = step->tile_b;
+			continue;
 		}
+
+		if (step->index_b < end_b)
+		{
+			step->end_b = end_b;
+			step->lineA = dm->observations_per_class[step->class_a
+													 * dm->n_observations
+													 + step->index_a];
+			step->lineB = dm->observations_per_class[step->class_b
+													 * dm->n_observations
+													 + step->index_b];
+			return;
+		}
+
+		// Next observation of class a in the tile
+		step->index_a++;
+		step->index_b = step->tile_b;
 	}
 
-	return OK;
+	// No more steps
+	step->lineA = NULL;
+	step->lineB = NULL;
 }
 
-oknok_t create_line_dataset(const dataset_hdf5_t* hdf5_dset,
-							const dataset_t* dset, const dm_t* dm)
+void find_next_step(const dm_t* dm, steps_t* step)
 {
+	const uint32_t* nopc = dm->n_observations_per_class;
+
+	if (dm->tile_size > 0)
+	{
+		find_next_blocked_step(dm, step);
+		return;
+	}
+
 	/**
-	 * Create line dataset
+	 * The lines are generated in this order:
+	 * for each class a
+	 *   for each observation of class a
+	 *     for each class b after class a
+	 *       for each observation of class b
 	 */
-	hid_t dset_id = hdf5_create_dataset(hdf5_dset->file_id, DM_LINE_DATA,
-										dm->n_matrix_lines, dset->n_words,
-										H5T_NATIVE_UINT64);
+	while (step->class_a + 1 < dm->n_classes)
+	{
+		if (step->index_a < nopc[step->class_a])
+		{
+			// Skip the classes b we're done with
+			while (step->class_b < dm->n_classes
+				   && step->index_b >= nopc[step->class_b])
+			{
+				step->class_b++;
+				step->index_b = 0;
+			}
 
-	// Write dataset attributes
-	herr_t err
-		= write_dm_attributes(dset_id, dset->n_attributes, dm->n_matrix_lines);
-	assert(err != NOK);
+			if (step->class_b < dm->n_classes)
+			{
+				step->end_b = nopc[step->class_b];
+				step->lineA = dm->observations_per_class[step->class_a
+														 * dm->n_observations
+														 + step->index_a];
+				step->lineB = dm->observations_per_class[step->class_b
+														 * dm->n_observations
+														 + step->index_b];
+				return;
+			}
+
+			// Next observation of class a
+			step->index_a++;
+		}
+		else
+		{
+			// Next class a
+			step->class_a++;
+			step->index_a = 0;
+		}
 
-	// Allocate output buffer
-	word_t* buffer
-		= (word_t*) malloc(N_LINES_OUT * dset->n_words * sizeof(word_t));
-	assert(buffer != NULL);
+		step->class_b = step->class_a + 1;
+		step->index_b = 0;
+	}
 
-	// Start of output buffer
-	word_t* start_buffer = buffer;
+	// No more steps
+	step->lineA = NULL;
+	step->lineB = NULL;
+}
+
+/**
+ * init_step for the blocked line order
+ */
+static void init_blocked_step(const dm_t* dm, const uint64_t line,
+							  steps_t* step)
+{
+	const uint32_t* nopc = dm->n_observations_per_class;
+	uint32_t tile_size	 = dm->tile_size;
 
-	// Current output line index
-	uint32_t offset = 0;
+	uint64_t remaining = line;
 
-	for (uint32_t cl = 0; cl < dm->n_matrix_lines; cl += N_LINES_OUT)
+	for (uint32_t ca = 0; ca + 1 < dm->n_classes; ca++)
 	{
-		for (uint32_t cll = cl;
-			 cll < cl + N_LINES_OUT && cll < dm->n_matrix_lines; cll++)
+		for (uint32_t cb = ca + 1; cb < dm->n_classes; cb++)
 		{
-			for (uint32_t w = 0; w < dset->n_words; w++, buffer++)
-			{
-				word_t* la = dm->steps[cll].lineA;
-				word_t* lb = dm->steps[cll].lineB;
+			uint32_t n_a = nopc[ca];
+			uint32_t n_b = nopc[cb];
 
-				(*buffer) = la[w] ^ lb[w];
+			uint64_t n_lines = (uint64_t) n_a * n_b;
+			if (remaining >= n_lines)
+			{
+				remaining -= n_lines;
+				continue;
 			}
+
+			step->class_a = ca;
+			step->class_b = cb;
+
+			// The full rows of tiles before the line
+			uint64_t row_lines = (uint64_t) tile_size * n_b;
+			step->tile_a	   = remaining / row_lines * tile_size;
+			remaining		   = remaining % row_lines;
+
+			// The tiles before the line in its row
+			uint32_t n_tile_a = n_a - step->tile_a < tile_size
+				? n_a - step->tile_a
+				: tile_size;
+			uint64_t tile_lines = (uint64_t) n_tile_a * tile_size;
+			step->tile_b		= remaining / tile_lines * tile_size;
+			remaining			= remaining % tile_lines;
+
+			uint32_t n_tile_b = n_b - step->tile_b < tile_size
+				? n_b - step->tile_b
+				: tile_size;
+			step->index_a = step->tile_a + remaining / n_tile_b;
+			step->index_b = step->tile_b + remaining % n_tile_b;
+
+			find_next_blocked_step(dm, step);
+			return;
+		}
+	}
+
+	// Past the last line
+	step->class_a = dm->n_classes > 0 ? dm->n_classes - 1 : 0;
+	step->lineA	  = NULL;
+	step->lineB	  = NULL;
+}
+
+void init_step(const dm_t* dm, const uint64_t line, steps_t* step)
+{
+	const uint32_t* nopc = dm->n_observations_per_class;
+
+	uint64_t remaining = line;
+
+	step->class_a = 0;
+	step->index_a = 0;
+	step->class_b = 1;
+	step->index_b = 0;
+	step->end_b	  = 0;
+	step->tile_a  = 0;
+	step->tile_b  = 0;
+
+	if (dm->tile_size > 0)
+	{
+		init_blocked_step(dm, line, step);
+		return;
+	}
+
+	for (uint32_t ca = 0; ca + 1 < dm->n_classes; ca++)
+	{
+		// Lines generated by each observation of class a
+		uint32_t n_lines_per_obs = 0;
+		for (uint32_t cb = ca + 1; cb < dm->n_classes; cb++)
+		{
+			n_lines_per_obs += nopc[cb];
 		}
 
-		// Number of lines to write
-		uint32_t n_lines_out = N_LINES_OUT;
-		if (cl + N_LINES_OUT > dm->n_matrix_lines)
+		uint64_t n_lines = (uint64_t) nopc[ca] * n_lines_per_obs;
+		if (remaining >= n_lines)
 		{
-			n_lines_out = dm->n_matrix_lines - cl;
+			remaining -= n_lines;
+			continue;
 		}
 
-		hdf5_write_n_lines(dset_id, offset, n_lines_out, dset->n_words,
-						   H5T_NATIVE_UINT64, start_buffer);
+		step->class_a = ca;
+		step->index_a = remaining / n_lines_per_obs;
+		remaining	  = remaining % n_lines_per_obs;
 
-		offset += n_lines_out;
-		buffer = start_buffer;
+		for (uint32_t cb = ca + 1; cb < dm->n_classes; cb++)
+		{
+			if (remaining < nopc[cb])
+			{
+				step->class_b = cb;
+				step->index_b = remaining;
+				break;
+			}
+
+			remaining -= nopc[cb];
+		}
+
+		find_next_step(dm, step);
+		return;
 	}
 
-	free(buffer);
+	// Past the last line
+	step->class_a = dm->n_classes > 0 ? dm->n_classes - 1 : 0;
+	step->lineA	  = NULL;
+	step->lineB	  = NULL;
+}
+
+oknok_t generate_dm_lines(const dm_t* dm, const uint32_t n_words,
+						  const uint64_t first, const uint64_t n_lines,
+						  word_t* lines)
+{
+	steps_t step;
+	init_step(dm, first, &step);
 
-	H5Dclose(dset_id);
+	for (uint64_t l = 0; l < n_lines && step.lineA != NULL; l++)
+	{
+		for (uint32_t w = 0; w < n_words; w++, lines++)
+		{
+			(*lines) = step.lineA[w] ^ step.lineB[w];
+		}
+
+		next_step(dm, &step);
+	}
 
 	return OK;
 }
 
-oknok_t create_column_dataset(const dataset_hdf5_t* hdf5_dset,
-							  const dataset_t* dset, const dm_t* dm)
+oknok_t generate_dm_column(const dm_t* dm, const uint32_t attribute,
+						   const uint64_t first_word, const uint64_t n_words,
+						   word_t* column)
 {
+	uint32_t attribute_word = attribute / WORD_BITS;
+	uint8_t attribute_bit	= WORD_BITS - (attribute % WORD_BITS) - 1;
 
-	// Number of words in a line ON OUTPUT DATASET
-	uint32_t out_n_words = dm->n_matrix_lines / WORD_BITS
-		+ (dm->n_matrix_lines % WORD_BITS != 0);
+#pragma omp parallel
+	{
+		uint32_t thread_id = omp_get_thread_num();
+		uint32_t n_threads = omp_get_num_threads();
 
-	/**
-	 * CREATE OUTPUT DATASET
-	 */
+		uint64_t from = n_words * thread_id / n_threads;
+		uint64_t to	  = n_words * (thread_id + 1) / n_threads;
 
-	hid_t dset_id = hdf5_create_dataset(hdf5_dset->file_id, DM_COLUMN_DATA,
-										dset->n_attributes, out_n_words,
-										H5T_NATIVE_UINT64);
+		steps_t step;
+		init_step(dm, (first_word + from) * WORD_BITS, &step);
 
-	/**
-	 * Create dataset to hold the totals
-	 */
-	hid_t totals_dset_id
-		= hdf5_create_dataset(hdf5_dset->file_id, DM_ATTRIBUTE_TOTALS, 1,
-							  dset->n_attributes, H5T_NATIVE_UINT32);
+		for (uint64_t w = from; w < to; w++)
+		{
+			word_t bits = 0;
+
+			// Lines are stored from the most significant bit
+			for (int8_t bit = WORD_BITS - 1; bit >= 0 && step.lineA != NULL;
+				 bit--)
+			{
+				if (BIT_CHECK(step.lineA[attribute_word]
+								  ^ step.lineB[attribute_word],
+							  attribute_bit))
+				{
+					BIT_SET(bits, bit);
+				}
+
+				next_step(dm, &step);
+			}
+
+			column[w] = bits;
+		}
+	}
+
+	return OK;
+}
+
+word_t* alloc_in_memory_dm(const uint64_t n_lines, const uint64_t n_words,
+						   uint64_t* memory_budget)
+{
+	uint64_t size = n_lines * n_words * sizeof(word_t);
+
+	if (size > *memory_budget)
+	{
+		return NULL;
+	}
+
+	word_t* data = (word_t*) malloc(size);
+	if (data == NULL)
+	{
+		// We can still use the dataset
+		return NULL;
+	}
+
+	*memory_budget -= size;
+
+	return data;
+}
+
+uint32_t get_dm_block_lines(const dataset_t* dset, const uint32_t block_size,
+							const uint32_t n_blocks, const uint64_t max_memory,
+							const bool line_data_in_memory,
+							const bool column_data_in_memory)
+{
+	uint32_t block_lines = block_size / WORD_BITS * WORD_BITS;
+	if (block_lines == 0)
+	{
+		block_lines = WORD_BITS;
+	}
+
+	if (max_memory == 0)
+	{
+		return block_lines;
+	}
 
 	/**
-	 * Attribute totals buffer
+	 * Memory used by a tile of WORD_BITS lines in each of the n_blocks:
+	 * its line totals, lines and column words
 	 */
-	uint32_t* attr_buffer = NULL;
+	uint64_t tile_size = WORD_BITS * sizeof(uint32_t);
+	if (!line_data_in_memory)
+	{
+		tile_size += (uint64_t) WORD_BITS * dset->n_words * sizeof(word_t);
+	}
 
-	// uint32_t n_words_to_process = dset->n_words;
+	if (!column_data_in_memory)
+	{
+		tile_size += (uint64_t) dset->n_attributes * sizeof(word_t);
+	}
 
-	// The attribute blocks to generate/save start at
-	// uint32_t attribute_block_start = 0;
-	// uint32_t attribute_block_end   = n_words_to_process;
+	uint64_t max_tiles = max_memory / (n_blocks * tile_size);
+	if (max_tiles == 0)
+	{
+		// A single tile is the least we can build
+		max_tiles = 1;
+	}
+
+	if (max_tiles < block_lines / WORD_BITS)
+	{
+		block_lines = max_tiles * WORD_BITS;
+	}
+
+	return block_lines;
+}
+
+/**
+ * Builds the tiles of WORD_BITS lines of the disjoint matrix in [first,
+ * first + n_lines), first being a multiple of WORD_BITS.
+ * Each line is XORed once into lines, its number of attributes is stored in
+ * line_totals and the tile is transposed into the column words of columns,
+ * whose lines are column_stride words apart
+ */
+static void build_tiles(const dm_t* dm, const uint32_t n_words,
+						const uint32_t n_attributes, const uint64_t first,
+						const uint32_t n_lines, word_t* lines,
+						word_t* columns, const uint64_t column_stride,
+						uint32_t* line_totals)
+{
+	if (n_lines == 0)
+	{
+		return;
+	}
+
+	word_t block[WORD_BITS];
+
+	steps_t step;
+	init_step(dm, first, &step);
+
+	for (uint32_t tl = 0; tl < n_lines; tl += WORD_BITS)
+	{
+		uint32_t n_tile_lines = WORD_BITS;
+		if (n_lines - tl < WORD_BITS)
+		{
+			n_tile_lines = n_lines - tl;
+		}
+
+		word_t* tile = lines + (uint64_t) tl * n_words;
+
+		// Build the lines of the tile
+		word_t* buffer = tile;
+		for (uint32_t l = 0; l < n_tile_lines; l++)
+		{
+			uint32_t total = 0;
+
+			for (uint32_t w = 0; w < n_words; w++, buffer++)
+			{
+				(*buffer) = step.lineA[w] ^ step.lineB[w];
+				total += __builtin_popcountl(*buffer);
+			}
+
+			line_totals[tl + l] = total;
+
+			next_step(dm, &step);
+		}
+
+		// Transpose the tile, one attribute word at a time
+		for (uint32_t w = 0; w < n_words; w++)
+		{
+			for (uint32_t l = 0; l < n_tile_lines; l++)
+			{
+				block[l] = tile[(uint64_t) l * n_words + w];
+			}
+
+			// Lines past the end of the matrix cover nothing
+			memset(block + n_tile_lines, 0,
+				   (WORD_BITS - n_tile_lines) * sizeof(word_t));
+
+			// Transpose a 64x64 block in place
+			transpose64(block);
+
+			uint32_t first_attribute   = w * WORD_BITS;
+			uint32_t n_tile_attributes = WORD_BITS;
+			if (n_attributes - first_attribute < WORD_BITS)
+			{
+				n_tile_attributes = n_attributes - first_attribute;
+			}
+
+			for (uint32_t a = 0; a < n_tile_attributes; a++)
+			{
+				columns[(first_attribute + a) * column_stride + tl / WORD_BITS]
+					= block[a];
+			}
+		}
+	}
+}
+
+oknok_t create_dm_datasets(const dataset_hdf5_t* hdf5_dset,
+						   const dataset_t* dset, const dm_t* dm,
+						   const uint32_t block_size, const uint32_t n_blocks,
+						   const dataset_layout_t* line_layout,
+						   const dataset_layout_t* column_layout,
+						   word_t* line_data, word_t* column_data)
+{
+	// Number of words in a line ON COLUMN DATASET
+	uint64_t out_n_words = dm->n_matrix_lines / WORD_BITS
+		+ (dm->n_matrix_lines % WORD_BITS != 0);
 
 	/**
-	 * Allocate input buffer
-	 *
-	 * Input buffer will hold one word per disjoint matrix line
-	 * Rounding to nearest multiple of 64 so we don't have to worry when
-	 * transposing the last lines
+	 * Create the datasets
 	 */
-	word_t* in_buffer = (word_t*) malloc(out_n_words * 64 * sizeof(word_t));
+	hid_t line_dset_id = H5I_INVALID_HID;
+	if (line_layout != NULL)
+	{
+		line_dset_id = hdf5_create_dataset(hdf5_dset->file_id, DM_LINE_DATA,
+										   dm->n_matrix_lines, dset->n_words,
+										   H5T_NATIVE_UINT64, line_layout);
+	}
+
+	hid_t column_dset_id
+		= hdf5_create_dataset(hdf5_dset->file_id, DM_COLUMN_DATA,
+							  dset->n_attributes, out_n_words,
+							  H5T_NATIVE_UINT64, column_layout);
+
+	// Write dataset attributes, on the column dataset if it's the only one
+	herr_t err = write_dm_attributes(
+		line_layout != NULL ? line_dset_id : column_dset_id,
+		dset->n_attributes, dm->n_matrix_lines, dm->tile_size);
+	assert(err != NOK);
+
+	hid_t totals_dset_id
+		= hdf5_create_dataset(hdf5_dset->file_id, DM_LINE_TOTALS, 1,
+							  dm->n_matrix_lines, H5T_NATIVE_UINT32, NULL);
+
+	// The blocks hold whole tiles
+	uint32_t block_lines = block_size / WORD_BITS * WORD_BITS;
+	if (block_lines == 0)
+	{
+		block_lines = WORD_BITS;
+	}
+
+	uint32_t block_words = block_lines / WORD_BITS;
 
 	/**
-	 * Allocate output buffer
-	 *
-	 * Will hold up the matrix lines of up to 64 attributes
+	 * The blocks being built or written, as lines, columns and line totals.
+	 * The lines and columns aren't needed if they are built straight into
+	 * the in-memory matrices.
 	 */
-	word_t* out_buffer = (word_t*) malloc(out_n_words * 64 * sizeof(word_t));
+	word_t** line_blocks	 = (word_t**) calloc(n_blocks, sizeof(word_t*));
+	word_t** column_blocks	 = (word_t**) calloc(n_blocks, sizeof(word_t*));
+	uint32_t** totals_blocks = (uint32_t**) calloc(n_blocks, sizeof(uint32_t*));
+	assert(line_blocks != NULL && column_blocks != NULL
+		   && totals_blocks != NULL);
+
+	for (uint32_t slot = 0; slot < n_blocks; slot++)
+	{
+		if (line_data == NULL)
+		{
+			line_blocks[slot] = (word_t*) malloc(
+				(uint64_t) block_lines * dset->n_words * sizeof(word_t));
+			assert(line_blocks[slot] != NULL);
+		}
 
-	// Start of the lines block to transpose
-	word_t* transpose_index = NULL;
+		if (column_data == NULL)
+		{
+			column_blocks[slot] = (word_t*) malloc(
+				(uint64_t) dset->n_attributes * block_words * sizeof(word_t));
+			assert(column_blocks[slot] != NULL);
+		}
+
+		totals_blocks[slot]
+			= (uint32_t*) malloc(block_lines * sizeof(uint32_t));
+		assert(totals_blocks[slot] != NULL);
+	}
 
 	/**
-	 * Allocate attribute totals buffer
-	 * We save the totals for each attribute.
-	 * This saves time when selecting the first best attribute
+	 * Task dependencies: the tiles of a block are built once its buffer is
+	 * free, and it's written once they're all built, after the previous
+	 * block. Only the addresses of the buffer flags matter
 	 */
-	attr_buffer = (uint32_t*) calloc(dset->n_attributes, sizeof(uint32_t));
-
-	uint32_t n_remaining_lines_to_write = dset->n_attributes;
+	char* buffer_ready = (char*) calloc(n_blocks, sizeof(char));
+	assert(buffer_ready != NULL);
+	uint64_t blocks_written = 0;
 
-	uint32_t n_lines_to_write = WORD_BITS;
+	uint64_t n_matrix_blocks = dm->n_matrix_lines / block_lines
+		+ (dm->n_matrix_lines % block_lines != 0);
 
-	for (uint32_t current_attribute_word = 0;
-		 current_attribute_word < dset->n_words;
-		 current_attribute_word++, n_remaining_lines_to_write -= 64)
+#pragma omp parallel
+#pragma omp single
 	{
+		// Every thread builds tiles and writes blocks as they're ready
+		uint32_t n_shares = omp_get_num_threads();
 
-		if (n_remaining_lines_to_write < 64)
+		for (uint64_t b = 0; b < n_matrix_blocks; b++)
 		{
-			n_lines_to_write = n_remaining_lines_to_write;
-		}
+			uint32_t slot	 = b % n_blocks;
+			uint64_t first	 = b * block_lines;
+			uint32_t n_lines = dm->n_matrix_lines - first < block_lines
+				? dm->n_matrix_lines - first
+				: block_lines;
+
+			word_t* lines = line_data != NULL
+				? line_data + first * dset->n_words
+				: line_blocks[slot];
+
+			// The column block has only the words of this block
+			word_t* columns		   = column_blocks[slot];
+			uint64_t column_stride = n_lines / WORD_BITS
+				+ (n_lines % WORD_BITS != 0);
+
+			if (column_data != NULL)
+			{
+				columns		  = column_data + first / WORD_BITS;
+				column_stride = out_n_words;
+			}
 
-		/**
-		 * !TODO: Confirm that generating the column is faster than
-		 * reading it from the line dataset
-		 */
-		generate_dm_column(dm, current_attribute_word, in_buffer);
-
-		transpose_index = in_buffer;
-
-		/**
-		 * Transpose all lines but the last one
-		 * The last word may not may not have 64 attributes
-		 * and we're working with garbage, but it's fine because
-		 * we trim them after the main loop
-		 */
-		uint32_t ow = 0;
-		for (ow = 0; ow < out_n_words - 1; ow++, transpose_index += 64)
-		{
-			// Transpose a 64x64 block in place
-			transpose64(transpose_index);
+			uint32_t n_tiles = n_lines / WORD_BITS + (n_lines % WORD_BITS != 0);
 
-			// Append to output buffer
-			for (uint8_t l = 0; l < n_lines_to_write; l++)
+			for (uint32_t share = 0; share < n_shares; share++)
 			{
-				out_buffer[l * out_n_words + ow] = transpose_index[l];
+				uint32_t from
+					= (uint64_t) n_tiles * share / n_shares * WORD_BITS;
+				uint32_t to
+					= (uint64_t) n_tiles * (share + 1) / n_shares * WORD_BITS;
+
+				if (to > n_lines)
+				{
+					to = n_lines;
+				}
 
-				// Update attribute totals
-				attr_buffer[current_attribute_word * WORD_BITS + l]
-					+= __builtin_popcountl(transpose_index[l]);
+#pragma omp task depend(in : buffer_ready[slot])
+				build_tiles(dm, dset->n_words, dset->n_attributes, first + from,
+							to - from, lines + (uint64_t) from * dset->n_words,
+							columns + from / WORD_BITS, column_stride,
+							totals_blocks[slot] + from);
+			}
+
+#pragma omp task depend(inout : buffer_ready[slot]) \
+	depend(inout : blocks_written)
+			{
+				if (line_layout != NULL)
+				{
+					hdf5_write_n_lines(line_dset_id, first, n_lines,
+									   dset->n_words, H5T_NATIVE_UINT64, lines);
+				}
+
+				// The in-memory column matrix is written at once in the end
+				if (column_data == NULL)
+				{
+					hsize_t offset[2] = { 0, first / WORD_BITS };
+					hsize_t count[2]  = { dset->n_attributes, column_stride };
+
+					hdf5_write_to_dataset(column_dset_id, offset, count,
+										  H5T_NATIVE_UINT64, columns);
+				}
+
+				hsize_t offset[2] = { 0, first };
+				hsize_t count[2]  = { 1, n_lines };
+
+				hdf5_write_to_dataset(totals_dset_id, offset, count,
+									  H5T_NATIVE_UINT32, totals_blocks[slot]);
+
+				blocks_written++;
 			}
 		}
+	}
+
+	assert(blocks_written == n_matrix_blocks);
+
+	if (column_data != NULL)
+	{
+		hdf5_write_n_lines(column_dset_id, 0, dset->n_attributes, out_n_words,
+						   H5T_NATIVE_UINT64, column_data);
+	}
+
+	for (uint32_t slot = 0; slot < n_blocks; slot++)
+	{
+		free(line_blocks[slot]);
+		free(column_blocks[slot]);
+		free(totals_blocks[slot]);
+	}
+
+	free(line_blocks);
+	free(column_blocks);
+	free(totals_blocks);
+	free(buffer_ready);
+
+	if (line_layout != NULL)
+	{
+		H5Dclose(line_dset_id);
+	}
+	H5Dclose(column_dset_id);
+	H5Dclose(totals_dset_id);
+
+	return OK;
+}
 
-		// Last word
+oknok_t calculate_attribute_totals(const dataset_t* dset,
+								   uint64_t* attribute_totals)
+{
+	uint32_t n_totals = dset->n_words * WORD_BITS;
+
+	/**
+	 * Number of observations of each class with each attribute set
+	 */
+	uint64_t* class_ones
+		= (uint64_t*) calloc(dset->n_classes * n_totals, sizeof(uint64_t));
+	assert(class_ones != NULL);
+
+	for (uint32_t c = 0; c < dset->n_classes; c++)
+	{
+		word_t** observations
+			= dset->observations_per_class + c * dset->n_observations;
+
+		bit_counters_t counters;
+		init_bit_counters(&counters, dset->n_words, class_ones + c * n_totals,
+						  false);
+
+		for (uint32_t o = 0; o < dset->n_observations_per_class[c]; o++)
+		{
+			bit_counters_add_line(&counters, observations[o]);
+		}
 
-		// Transpose
-		transpose64(transpose_index);
+		bit_counters_flush(&counters);
+		free_bit_counters(&counters);
+	}
 
-		// If it's last word we may have to mask the last bits that are noise
-		word_t n_bits_to_check_mask = 0xffffffffffffffff
-			<< (out_n_words * 64 - dm->n_matrix_lines);
+	/**
+	 * Each line from the class pair (i, j) has attribute a set if only one
+	 * of the observations has it:
+	 * ones_i[a] * zeros_j[a] + zeros_i[a] * ones_j[a]
+	 */
+	for (uint32_t a = 0; a < dset->n_attributes; a++)
+	{
+		uint64_t total = 0;
 
-		// Append to output buffer
-		for (uint8_t l = 0; l < n_lines_to_write; l++)
+		for (uint32_t i = 0; i < dset->n_classes; i++)
 		{
-			transpose_index[l] &= n_bits_to_check_mask;
+			uint64_t ones_i	 = class_ones[i * n_totals + a];
+			uint64_t zeros_i = dset->n_observations_per_class[i] - ones_i;
 
-			out_buffer[l * out_n_words + ow] = transpose_index[l];
+			for (uint32_t j = i + 1; j < dset->n_classes; j++)
+			{
+				uint64_t ones_j	 = class_ones[j * n_totals + a];
+				uint64_t zeros_j = dset->n_observations_per_class[j] - ones_j;
 
-			// Update attribute totals
-			attr_buffer[current_attribute_word * WORD_BITS + l]
-				+= __builtin_popcountl(transpose_index[l]);
+				total += ones_i * zeros_j + zeros_i * ones_j;
+			}
 		}
 
-		// Save transposed array to file
-		hdf5_write_n_lines(dset_id, current_attribute_word * 64,
-						   n_lines_to_write, out_n_words, H5T_NATIVE_UINT64,
-						   out_buffer);
+		attribute_totals[a] = total;
 	}
 
-	free(out_buffer);
-	free(in_buffer);
+	free(class_ones);
 
-	H5Dclose(dset_id);
+	return OK;
+}
+
+oknok_t create_attribute_totals_dataset(const dataset_hdf5_t* hdf5_dset,
+										const uint32_t n_attributes,
+										const uint64_t* attribute_totals)
+{
+	hid_t dset_id
+		= hdf5_create_dataset(hdf5_dset->file_id, DM_ATTRIBUTE_TOTALS, 1,
+							  n_attributes, H5T_NATIVE_UINT64, NULL);
 
-	write_attribute_totals(totals_dset_id, dset->n_attributes, attr_buffer);
+	write_attribute_totals(dset_id, n_attributes, attribute_totals);
 
-	free(attr_buffer);
-	H5Dclose(totals_dset_id);
+	H5Dclose(dset_id);
 
 	return OK;
 }
 
 oknok_t write_attribute_totals(const hid_t dataset_id,
 							   const uint32_t n_attributes,
-							   const uint32_t* data)
+							   const uint64_t* data)
 {
 
 	hsize_t offset[2] = { 0, 0 };
 	hsize_t count[2]  = { 1, n_attributes };
 
-	hdf5_write_to_dataset(dataset_id, offset, count, H5T_NATIVE_UINT32, data);
+	hdf5_write_to_dataset(dataset_id, offset, count, H5T_NATIVE_UINT64, data);
 
 	return OK;
 }
+
+oknok_t create_observations_dataset(const dataset_hdf5_t* hdf5_dset,
+									const dataset_t* dset,
+									const uint32_t tile_size)
+{
+	uint32_t n_observations = 0;
+	for (uint32_t c = 0; c < dset->n_classes; c++)
+	{
+		n_observations += dset->n_observations_per_class[c];
+	}
+
+	// The observations of each class together, in the class order
+	word_t* observations = (word_t*) malloc(
+		(uint64_t) n_observations * dset->n_words * sizeof(word_t));
+	assert(n_observations == 0 || observations != NULL);
+
+	word_t* observation = observations;
+	for (uint32_t c = 0; c < dset->n_classes; c++)
+	{
+		word_t* const* class_observations
+			= dset->observations_per_class + c * dset->n_observations;
+
+		for (uint32_t o = 0; o < dset->n_observations_per_class[c]; o++)
+		{
+			memcpy(observation, class_observations[o],
+				   dset->n_words * sizeof(word_t));
+			observation += dset->n_words;
+		}
+	}
+
+	hid_t dset_id
+		= hdf5_create_dataset(hdf5_dset->file_id, DM_OBSERVATIONS,
+							  n_observations, dset->n_words, H5T_NATIVE_UINT64,
+							  NULL);
+
+	hdf5_write_n_lines(dset_id, 0, n_observations, dset->n_words,
+					   H5T_NATIVE_UINT64, observations);
+
+	hdf5_write_attribute(dset_id, N_CLASSES_ATTR, H5T_NATIVE_UINT,
+						 &dset->n_classes);
+
+	herr_t err = write_dm_attributes(dset_id, dset->n_attributes,
+									 get_dm_n_lines(dset), tile_size);
+	assert(err != NOK);
+
+	H5Dclose(dset_id);
+
+	dset_id = hdf5_create_dataset(hdf5_dset->file_id,
+								  DM_OBSERVATIONS_PER_CLASS, 1,
+								  dset->n_classes, H5T_NATIVE_UINT32, NULL);
+
+	hdf5_write_n_lines(dset_id, 0, 1, dset->n_classes, H5T_NATIVE_UINT32,
+					   dset->n_observations_per_class);
+
+	H5Dclose(dset_id);
+
+	free(observations);
+
+	return OK;
+}
+
+oknok_t read_observations_dataset(const hid_t file_id, dataset_t* dset,
+								  uint32_t* tile_size)
+{
+	hid_t dset_id = H5Dopen(file_id, DM_OBSERVATIONS, H5P_DEFAULT);
+	assert(dset_id != NOK);
+
+	hsize_t dimensions[2];
+	hdf5_get_dataset_dimensions(dset_id, dimensions);
+
+	hdf5_read_attribute(dset_id, N_CLASSES_ATTR, H5T_NATIVE_UINT32,
+						&dset->n_classes);
+	hdf5_read_attribute(dset_id, N_ATTRIBUTES_ATTR, H5T_NATIVE_UINT32,
+						&dset->n_attributes);
+	hdf5_read_attribute(dset_id, LINE_ORDER_TILE_ATTR, H5T_NATIVE_UINT32,
+						tile_size);
+
+	dset->n_observations = dimensions[0];
+	dset->n_words		 = dimensions[1];
+
+	dset->data = (word_t*) malloc((uint64_t) dset->n_observations
+								  * dset->n_words * sizeof(word_t));
+	assert(dset->n_observations == 0 || dset->data != NULL);
+
+	oknok_t ret = OK;
+	if (dset->n_observations > 0)
+	{
+		ret = hdf5_read_dataset_data(dset_id, dset->data);
+	}
+
+	H5Dclose(dset_id);
+
+	dset->n_observations_per_class
+		= (uint32_t*) calloc(dset->n_classes, sizeof(uint32_t));
+	assert(dset->n_observations_per_class != NULL);
+
+	dset_id = H5Dopen(file_id, DM_OBSERVATIONS_PER_CLASS, H5P_DEFAULT);
+	assert(dset_id != NOK);
+
+	hsize_t offset[2] = { 0, 0 };
+	hsize_t count[2]  = { 1, dset->n_classes };
+
+	if (ret == OK)
+	{
+		ret = hdf5_read_from_dataset(dset_id, offset, count,
+									 H5T_NATIVE_UINT32,
+									 dset->n_observations_per_class);
+	}
+
+	H5Dclose(dset_id);
+
+	// Rebuild the class buckets, the observations are grouped by class
+	dset->observations_per_class = (word_t**) calloc(
+		(uint64_t) dset->n_classes * dset->n_observations, sizeof(word_t*));
+	assert(dset->observations_per_class != NULL);
+
+	word_t* observation = dset->data;
+	for (uint32_t c = 0; c < dset->n_classes; c++)
+	{
+		for (uint32_t o = 0; o < dset->n_observations_per_class[c]; o++)
+		{
+			dset->observations_per_class[c * dset->n_observations + o]
+				= observation;
+			observation += dset->n_words;
+		}
+	}
+
+	return ret;
+}
@@ -10,9 +10,12 @@
 #define DISJOINT_MATRIX_H
 
 #include "types/dataset_hdf5_t.h"
+#include "types/dataset_layout_t.h"
 #include "types/dataset_t.h"
 #include "types/dm_t.h"
 #include "types/oknok_t.h"
+#include "types/steps_t.h"
+#include "types/word_t.h"
 
 #include "hdf5.h"
 
@@ -20,53 +23,165 @@
 #include <stdint.h>
 
 /**
- * Number of lines to buffer before output
- * Only used in the line dataset, because we already write WORD_BITS columns at
- * a time in the column dataset
+ * Size (in bytes) of the cache the observations of a tile of the blocked
+ * line order should fit in
  */
-#define N_LINES_OUT 260
+#define DM_TILE_CACHE_SIZE (256 * 1024)
 
 /**
  * Calculates the number of lines for the disjoint matrix
  */
-uint32_t get_dm_n_lines(const dataset_t* dataset);
+uint64_t get_dm_n_lines(const dataset_t* dataset);
 
 /**
- * Builds one column of the disjoint matriz
- * One column represents WORD_BITS attributes. It's equivalent to reading
- * the first word from every line from the line disjoint matrix
+ * Writes the matrix atributes in the dataset
  */
-oknok_t generate_dm_column(const dm_t* dm, const int column, word_t* buffer);
+herr_t write_dm_attributes(const hid_t dataset_id, const uint32_t n_attributes,
+						   const uint64_t n_matrix_lines,
+						   const uint32_t tile_size);
 
 /**
- * Writes the matrix atributes in the dataset
+ * Returns the number of observations of each class in the tiles of the
+ * blocked line order, so that the observations of both classes of a tile
+ * fit in DM_TILE_CACHE_SIZE
  */
-herr_t write_dm_attributes(const hid_t dataset_id, const uint32_t n_attributes,
-						   const uint32_t n_matrix_lines);
+uint32_t get_dm_tile_size(const uint32_t n_words);
+
+/**
+ * Sets up the steps for the disjoint matrix dm.
+ * The steps aren't stored, they are derived on demand from the dataset
+ * class buckets, so the dataset must outlive dm.
+ * If tile_size isn't 0 the lines are generated in the blocked order, for
+ * each pair of classes, in tiles of tile_size observations of each class
+ */
+oknok_t init_dm_steps(const dataset_t* dataset, const uint32_t tile_size,
+					  dm_t* dm);
+
+/**
+ * Sets step to the pair of observations that generate the matrix line
+ */
+void init_step(const dm_t* dm, const uint64_t line, steps_t* step);
+
+/**
+ * Moves step forward to the first valid pair of observations, starting at
+ * its current position. Used by next_step when the run of observations of
+ * class b ends
+ */
+void find_next_step(const dm_t* dm, steps_t* step);
+
+/**
+ * Moves step to the next matrix line
+ */
+static inline void next_step(const dm_t* dm, steps_t* step)
+{
+	step->index_b++;
+
+	if (step->index_b < step->end_b)
+	{
+		// Same observation of class a, just the next one of class b
+		step->lineB = dm->observations_per_class[step->class_b
+												 * dm->n_observations
+												 + step->index_b];
+		return;
+	}
+
+	find_next_step(dm, step);
+}
 
 /**
- * Generates the steps for the partial disjoint matrix dm
+ * Generates n_lines lines of the disjoint matrix, of n_words each, starting
+ * at line first
  */
-oknok_t generate_steps(const dataset_t* dataset, dm_t* dm);
+oknok_t generate_dm_lines(const dm_t* dm, const uint32_t n_words,
+						  const uint64_t first, const uint64_t n_lines,
+						  word_t* lines);
 
 /**
- * Creates the dataset containing the disjoint matrix with attributes as columns
+ * Generates the column of the attribute, n_words starting at first_word.
+ * The words are split between the available threads
  */
-oknok_t create_line_dataset(const dataset_hdf5_t* hdf5_dset,
-							const dataset_t* dset, const dm_t* dm);
+oknok_t generate_dm_column(const dm_t* dm, const uint32_t attribute,
+						   const uint64_t first_word, const uint64_t n_words,
+						   word_t* column);
 
 /**
- * Creates the dataset containing the disjoint matrix with attributes as
- * lines
+ * Allocates memory to keep a disjoint matrix with n_lines of n_words in
+ * memory, if it fits in the remaining memory budget (in bytes).
+ * The memory budget is updated.
+ * Returns NULL if the matrix doesn't fit
  */
-oknok_t create_column_dataset(const dataset_hdf5_t* hdf5_dset,
-							  const dataset_t* dset, const dm_t* dm);
+word_t* alloc_in_memory_dm(const uint64_t n_lines, const uint64_t n_words,
+						   uint64_t* memory_budget);
+
+/**
+ * Returns the number of lines to build at a time, at most block_size and
+ * a multiple of WORD_BITS, so that the n_blocks block buffers of
+ * create_dm_datasets fit in max_memory bytes. 0 means there's no limit.
+ * The lines or the columns don't need buffers if they're kept in memory
+ */
+uint32_t get_dm_block_lines(const dataset_t* dset, const uint32_t block_size,
+							const uint32_t n_blocks, const uint64_t max_memory,
+							const bool line_data_in_memory,
+							const bool column_data_in_memory);
+
+/**
+ * Creates the datasets containing the disjoint matrix, with attributes as
+ * columns and as lines, and the number of attributes set in each line.
+ * Each tile of WORD_BITS lines is built once and transposed into the
+ * columns. The tiles are built in parallel, block_size lines at a time,
+ * in n_blocks buffers: a block is written as soon as it's built, while
+ * the next ones are built in the other buffers.
+ * The line and column datasets are stored with line_layout and
+ * column_layout. If line_layout is NULL there's no line dataset, the lines
+ * are read from the tiles of the column dataset. If column_layout is NULL
+ * the column dataset is contiguous.
+ * If line_data and column_data are not NULL the full matrices are also kept
+ * there
+ */
+oknok_t create_dm_datasets(const dataset_hdf5_t* hdf5_dset,
+						   const dataset_t* dset, const dm_t* dm,
+						   const uint32_t block_size, const uint32_t n_blocks,
+						   const dataset_layout_t* line_layout,
+						   const dataset_layout_t* column_layout,
+						   word_t* line_data, word_t* column_data);
+
+/**
+ * Calculates the number of disjoint matrix lines covered by each attribute,
+ * without building the matrix, from the number of observations of each
+ * class that have each attribute set.
+ * attribute_totals must hold n_words * WORD_BITS totals
+ */
+oknok_t calculate_attribute_totals(const dataset_t* dset,
+								   uint64_t* attribute_totals);
+
+/**
+ * Creates the dataset holding the attribute totals
+ */
+oknok_t create_attribute_totals_dataset(const dataset_hdf5_t* hdf5_dset,
+										const uint32_t n_attributes,
+										const uint64_t* attribute_totals);
 
 /**
  * Writes the attribute totals metadata to the dataset
  */
 oknok_t write_attribute_totals(const hid_t dataset_id,
 							   const uint32_t n_attributes,
-							   const uint32_t* data);
+							   const uint64_t* data);
+
+/**
+ * Creates the datasets holding the observations that generate the disjoint
+ * matrix lines, so the matrix can be generated again without going through
+ * the original dataset
+ */
+oknok_t create_observations_dataset(const dataset_hdf5_t* hdf5_dset,
+									const dataset_t* dset,
+									const uint32_t tile_size);
+
+/**
+ * Reads the observations stored by create_observations_dataset into dset,
+ * with its class buckets, and the tile size of the line order
+ */
+oknok_t read_observations_dataset(const hid_t file_id, dataset_t* dset,
+								  uint32_t* tile_size);
 
 #endif
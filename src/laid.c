@@ -10,16 +10,27 @@
 #include "dataset_hdf5.h"
 #include "disjoint_matrix.h"
 #include "jnsq.h"
+#include "partition.h"
 #include "set_cover.h"
 #include "set_cover_hdf5.h"
+#include "sparse_columns.h"
+#include "strategy.h"
+#include "working_set.h"
 #include "types/cover_t.h"
 #include "types/dataset_hdf5_t.h"
+#include "types/dataset_layout_t.h"
 #include "types/dataset_t.h"
 #include "types/dm_t.h"
-#include "types/steps_t.h"
+#include "types/heap_t.h"
+#include "types/io_stats_t.h"
+#include "types/partition_t.h"
+#include "types/sparse_column_t.h"
+#include "types/strategy_t.h"
 #include "types/word_t.h"
+#include "types/working_set_t.h"
 #include "utils/bit.h"
 #include "utils/clargs.h"
+#include "utils/heap.h"
 #include "utils/sort_r.h"
 #include "utils/timing.h"
 
@@ -27,12 +38,19 @@
 
 #include <assert.h>
 #include <math.h>
+#include <omp.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
 /**
  * Reads dataset attributes from hdf5 file
  * Read dataset
@@ -58,6 +76,55 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	if (args.n_threads > 0)
+	{
+		omp_set_num_threads(args.n_threads);
+	}
+
+	if (args.deflate_level > 0 && H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0)
+	{
+		fprintf(stderr, "The deflate filter is not available\n");
+		return EXIT_FAILURE;
+	}
+
+	/**
+	 * Size (in bytes) of the chunk cache of each disjoint matrix dataset
+	 */
+	uint64_t chunk_cache_size = (uint64_t) args.chunk_cache * 1024 * 1024;
+
+	/**
+	 * Processes sharing the set cover work, each one handles a slice
+	 * of the disjoint matrix lines
+	 */
+	int mpi_rank = 0;
+	int mpi_size = 1;
+
+#ifdef USE_MPI
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+
+	if (args.lazy && mpi_size > 1)
+	{
+		fprintf(stderr, "Lazy selection is not available with MPI\n");
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	if (args.partition && mpi_size > 1)
+	{
+		fprintf(stderr, "Partition set cover is not available with MPI\n");
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	// Only the first process reports progress
+	if (mpi_rank != 0 && freopen("/dev/null", "w", stdout) == NULL)
+	{
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+#endif
+
 	/**
 	 * Timing for the full operation
 	 */
@@ -84,23 +151,72 @@ int main(int argc, char** argv)
 	 */
 	dm_t dm;
 
+	/**
+	 * Remaining memory available to keep the disjoint matrix in memory
+	 */
+	uint64_t memory_budget = (uint64_t) args.memory_budget * 1024 * 1024;
+
+	/**
+	 * The disjoint matrix, if it fits in memory
+	 */
+	word_t* line_data	= NULL;
+	word_t* column_data = NULL;
+
 	// Open dataset file
 	printf("Using dataset '%s'\n", args.filename);
 
+	if (mpi_rank != 0)
+	{
+		// Only the first process builds the disjoint matrix
+		goto apply_set_cover;
+	}
+
 	if (hdf5_open_dataset(args.filename, args.datasetname, &hdf5_dset) == NOK)
 	{
+#ifdef USE_MPI
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+#endif
 		return EXIT_FAILURE;
 	}
 
 	/*We can jump straight to the set covering algorithm
 	  if we already have the matrix in the hdf5 dataset*/
 	uint8_t skip_dm_creation
-		= hdf5_dataset_exists(hdf5_dset.file_id, DM_LINE_DATA);
+		= hdf5_dataset_exists(hdf5_dset.file_id, DM_COLUMN_DATA);
 
-	if (skip_dm_creation)
+	if (args.virtual_matrix)
+	{
+		// The observations are all we need to generate the matrix
+		skip_dm_creation
+			= hdf5_dataset_exists(hdf5_dset.file_id, DM_OBSERVATIONS);
+	}
+
+	// The partition set cover always needs the original dataset
+	if (skip_dm_creation && !args.partition)
 	{
 		// We don't have to build the disjoint matrix!
-		printf("Disjoint matrix dataset found.\n\n");
+		printf("Disjoint matrix %s found.\n\n",
+			   args.virtual_matrix ? "observations" : "dataset");
+
+		if (args.sparse_columns && !args.virtual_matrix
+			&& !hdf5_dataset_exists(hdf5_dset.file_id, DM_SPARSE_COLUMNS))
+		{
+			printf("Storing the sparse columns: ");
+			TICK;
+
+			hid_t column_id
+				= H5Dopen(hdf5_dset.file_id, DM_COLUMN_DATA, H5P_DEFAULT);
+			assert(column_id != NOK);
+
+			hsize_t column_dimensions[2];
+			hdf5_get_dataset_dimensions(column_id, column_dimensions);
+			H5Dclose(column_id);
+
+			create_sparse_columns(hdf5_dset.file_id, NULL,
+								  column_dimensions[0], column_dimensions[1]);
+
+			TOCK;
+		}
 
 		goto apply_set_cover;
 	}
@@ -221,6 +337,101 @@ int main(int argc, char** argv)
 
 	// End setup dataset
 
+	if (args.partition)
+	{
+		/**
+		 * The uncovered lines are the pairs of observations of different
+		 * classes in the same block of the partition, so we can apply the
+		 * set cover straight from the dataset
+		 */
+		printf("Applying set covering algorithm:\n");
+		TICK;
+
+		H5Dclose(hdf5_dset.dataset_id);
+
+		cover_t cover;
+		init_cover(&cover);
+
+		cover.n_attributes		= dataset.n_attributes;
+		cover.n_words_in_a_line = dataset.n_words;
+		cover.n_matrix_lines	= get_dm_n_lines(&dataset);
+		cover.n_uncovered_lines = cover.n_matrix_lines;
+
+		cover.attribute_totals = (uint64_t*) calloc(
+			cover.n_words_in_a_line * WORD_BITS, sizeof(uint64_t));
+		assert(cover.attribute_totals != NULL);
+
+		cover.selected_attributes
+			= (word_t*) calloc(cover.n_words_in_a_line, sizeof(word_t));
+		assert(cover.selected_attributes != NULL);
+
+		partition_t partition;
+		init_partition(&partition, &dataset);
+
+		while (cover.n_uncovered_lines > 0)
+		{
+			update_attribute_totals_partition(&cover, &partition);
+
+			int64_t best_attribute = get_best_attribute_index(
+				cover.attribute_totals, cover.n_attributes);
+
+			printf("  Selected attribute #%ld, ", best_attribute);
+			printf("covers %lu lines ", cover.attribute_totals[best_attribute]);
+			TOCK;
+			TICK;
+
+			mark_attribute_as_selected(&cover, best_attribute);
+
+			// Update number of lines remaining
+			cover.n_uncovered_lines -= cover.attribute_totals[best_attribute];
+
+			// Split the blocks by the value of the selected attribute
+			refine_partition(&partition, best_attribute);
+		}
+
+		print_solution(stdout, &cover);
+		printf("All done! ");
+
+		PRINT_TIMING_GLOBAL;
+
+		free_partition(&partition);
+		free_cover(&cover);
+		free_dataset(&dataset);
+
+		H5Fclose(hdf5_dset.file_id);
+
+#ifdef USE_MPI
+		MPI_Finalize();
+#endif
+
+		return EXIT_SUCCESS;
+	}
+
+	/**
+	 * The attribute totals don't need the disjoint matrix, so they're ready
+	 * for the first attribute selection before the matrix is built
+	 */
+	printf("Calculating attribute totals: ");
+	TICK;
+
+	uint64_t* attribute_totals = (uint64_t*) calloc(
+		dataset.n_words * WORD_BITS, sizeof(uint64_t));
+	assert(attribute_totals != NULL);
+
+	calculate_attribute_totals(&dataset, attribute_totals);
+
+	// They may be there already, if the matrix was stored the other way
+	if (!hdf5_dataset_exists(hdf5_dset.file_id, DM_ATTRIBUTE_TOTALS))
+	{
+		create_attribute_totals_dataset(&hdf5_dset, dataset.n_attributes,
+										attribute_totals);
+	}
+
+	free(attribute_totals);
+	attribute_totals = NULL;
+
+	TOCK;
+
 	// Calculate disjoint matrix lines
 	printf("Building disjoint matrix: ");
 	TICK;
@@ -228,47 +439,160 @@ int main(int argc, char** argv)
 	// Calculate the number of disjoint matrix lines
 	dm.n_matrix_lines = get_dm_n_lines(&dataset);
 
-	dm.steps = (steps_t*) malloc(dm.n_matrix_lines * sizeof(steps_t));
-	generate_steps(&dataset, &dm);
+	uint32_t tile_size = 0;
+	if (args.blocked_order)
+	{
+		tile_size = get_dm_tile_size(dataset.n_words);
+	}
+
+	init_dm_steps(&dataset, tile_size, &dm);
 
 	TOCK;
 
-	printf("  Number of lines in the disjoint matrix: %d\n", dm.n_matrix_lines);
+	printf("  Number of lines in the disjoint matrix: %lu\n",
+		   dm.n_matrix_lines);
+
+	if (tile_size > 0)
+	{
+		printf("  Blocked line order, tiles of %d observations\n", tile_size);
+	}
 
 	double matrix_size = ((double) dm.n_matrix_lines * dataset.n_attributes)
 		/ (1024.0 * 1024 * 1024 * 8);
-	printf("  Estimated disjoint matrix size: %3.2fGB (x2)\n", matrix_size);
+	printf("  Estimated disjoint matrix size: %3.2fGB (x%d)\n", matrix_size,
+		   args.single_copy ? 1 : 2);
+
+	if (args.virtual_matrix)
+	{
+		/**
+		 * The matrix isn't stored, its lines are generated from the
+		 * observations when needed. The observations are stored instead,
+		 * so the next runs don't have to prepare them again.
+		 */
+		create_observations_dataset(&hdf5_dset, &dataset, tile_size);
+
+		printf("  Observations stored, the matrix will be generated\n");
+
+		goto apply_set_cover;
+	}
+
+	/**
+	 * Keep the matrix in memory if it fits in the budget.
+	 * The line matrix is the one we use the most, so it goes first.
+	 * With several processes each one loads only its slice later.
+	 */
+	if (mpi_size == 1)
+	{
+		line_data = alloc_in_memory_dm(dm.n_matrix_lines, dataset.n_words,
+									   &memory_budget);
+
+		column_data = alloc_in_memory_dm(
+			dataset.n_attributes,
+			dm.n_matrix_lines / WORD_BITS
+				+ (dm.n_matrix_lines % WORD_BITS != 0),
+			&memory_budget);
+	}
+
+	uint32_t block_lines = get_dm_block_lines(
+		&dataset, args.write_block_size, args.write_blocks,
+		(uint64_t) args.tile_memory * 1024 * 1024, line_data != NULL,
+		column_data != NULL);
+
+	printf("  Building %d lines at a time, %d blocks at once\n", block_lines,
+		   args.write_blocks);
+
+	/**
+	 * The chunks follow the accesses: the line dataset is read in blocks
+	 * of lines and the column dataset is written in blocks of lines and
+	 * read one attribute at a time.
+	 * Stored once, the column dataset is also read in tiles of WORD_BITS
+	 * attributes to get the lines.
+	 */
+	dataset_layout_t line_layout
+		= { { 0, 0 }, args.deflate_level, chunk_cache_size };
+	dataset_layout_t column_layout = line_layout;
+
+	if (args.chunked)
+	{
+		line_layout.chunk_dimensions[0]	  = args.block_size;
+		line_layout.chunk_dimensions[1]	  = dataset.n_words;
+		column_layout.chunk_dimensions[0] = args.single_copy ? WORD_BITS : 1;
+		column_layout.chunk_dimensions[1] = block_lines / WORD_BITS;
+
+		printf("  Chunks of %d lines and of %lu words of %llu column(s)",
+			   args.block_size, block_lines / WORD_BITS,
+			   column_layout.chunk_dimensions[0]);
+		if (args.deflate_level > 0)
+		{
+			printf(", deflate level %d", args.deflate_level);
+		}
+		printf("\n");
+	}
 
 	TICK;
 
 	// Build the disjoint matrix and store it in the hdf5 file
-	create_line_dataset(&hdf5_dset, &dataset, &dm);
+	create_dm_datasets(&hdf5_dset, &dataset, &dm, block_lines,
+					   args.write_blocks,
+					   args.single_copy ? NULL : &line_layout, &column_layout,
+					   line_data, column_data);
 
-	printf("  Line dataset done: ");
+	printf("  Line and column datasets done: ");
 	TOCK;
 
-	TICK;
+	if (args.sparse_columns)
+	{
+		TICK;
 
-	create_column_dataset(&hdf5_dset, &dataset, &dm);
+		create_sparse_columns(hdf5_dset.file_id, column_data,
+							  dataset.n_attributes,
+							  dm.n_matrix_lines / WORD_BITS
+								  + (dm.n_matrix_lines % WORD_BITS != 0));
 
-	printf("  Column dataset done: ");
-	TOCK;
+		printf("  Sparse columns done: ");
+		TOCK;
+	}
+
+	io_stats_t io_stats;
+	hdf5_get_io_stats(&io_stats);
+
+	if (io_stats.bytes_written > 0)
+	{
+		printf("  Wrote %3.2fMB in %3.2fs (%3.2fMB/s)\n",
+			   io_stats.bytes_written / (1024.0 * 1024), io_stats.write_time,
+			   io_stats.bytes_written / (1024.0 * 1024) / io_stats.write_time);
+	}
 
 	/*
 	  We no longer need the original dataset
 	 */
 	free_dataset(&dataset);
 
-	free(dm.steps);
-	dm.steps = NULL;
-
 apply_set_cover:
 
 	printf("Applying set covering algorithm:\n");
 	TICK;
 
 	// We no longer need to keep the original dataset open
-	H5Dclose(hdf5_dset.dataset_id);
+	if (mpi_rank == 0)
+	{
+		H5Dclose(hdf5_dset.dataset_id);
+
+		/**
+		 * We may have just written the disjoint matrix, with the file set
+		 * up for writing. Close it to flush it and open it read-only with
+		 * the default settings, the set cover only reads from it.
+		 */
+		H5Fclose(hdf5_dset.file_id);
+	}
+
+#ifdef USE_MPI
+	// The other processes wait for the disjoint matrix
+	MPI_Barrier(MPI_COMM_WORLD);
+#endif
+
+	hdf5_dset.file_id = H5Fopen(args.filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+	assert(hdf5_dset.file_id != NOK);
 
 	/**
 	 *  - Setup line covered array -> 0
@@ -287,45 +611,205 @@ apply_set_cover:
 	cover_t cover;
 	init_cover(&cover);
 
-	// Open the line dataset
-	hid_t d_id = H5Dopen(hdf5_dset.file_id, DM_LINE_DATA, H5P_DEFAULT);
-	assert(d_id != NOK);
-
+	dataset_hdf5_t column_dset_id;
 	dataset_hdf5_t line_dset_id;
-	line_dset_id.file_id	= hdf5_dset.file_id;
-	line_dset_id.dataset_id = d_id;
-	hdf5_get_dataset_dimensions(d_id, line_dset_id.dimensions);
 
-	// Open the column dataset
-	d_id = H5Dopen(hdf5_dset.file_id, DM_COLUMN_DATA, H5P_DEFAULT);
-	assert(d_id != NOK);
+	if (args.virtual_matrix)
+	{
+		// The other processes, or a new run, read back the observations
+		if (dataset.data == NULL)
+		{
+			uint32_t line_order_tile = 0;
+			read_observations_dataset(hdf5_dset.file_id, &dataset,
+									  &line_order_tile);
 
-	dataset_hdf5_t column_dset_id;
-	column_dset_id.file_id	  = hdf5_dset.file_id;
-	column_dset_id.dataset_id = d_id;
-	hdf5_get_dataset_dimensions(d_id, column_dset_id.dimensions);
+			dm.n_matrix_lines = get_dm_n_lines(&dataset);
+			init_dm_steps(&dataset, line_order_tile, &dm);
+		}
 
-	/**
-	 * If we skipped the matriz generation, dataset and dm are empty.
-	 * So we need to read the attributes from the dataset
-	 */
-	hdf5_read_attribute(line_dset_id.dataset_id, N_MATRIX_LINES_ATTR,
-						H5T_NATIVE_UINT32, &cover.n_matrix_lines);
-	hdf5_read_attribute(line_dset_id.dataset_id, N_ATTRIBUTES_ATTR,
-						H5T_NATIVE_UINT32, &cover.n_attributes);
+		// Neither dataset is stored, they're both generated from dm
+		column_dset_id.file_id		 = hdf5_dset.file_id;
+		column_dset_id.dataset_id	 = H5I_INVALID_HID;
+		column_dset_id.dimensions[0] = dataset.n_attributes;
+		column_dset_id.dimensions[1] = dm.n_matrix_lines / WORD_BITS
+			+ (dm.n_matrix_lines % WORD_BITS != 0);
+		column_dset_id.tiles = NULL;
+		column_dset_id.dm	 = &dm;
+		column_dset_id.map	 = NULL;
+
+		line_dset_id			   = column_dset_id;
+		line_dset_id.dimensions[0] = dm.n_matrix_lines;
+		line_dset_id.dimensions[1] = dataset.n_words;
+
+		cover.n_matrix_lines = dm.n_matrix_lines;
+		cover.n_attributes	 = dataset.n_attributes;
+
+		printf("  Disjoint matrix generated from %d observations\n",
+			   dataset.n_observations);
+	}
+	else
+	{
+		// Open the column dataset
+		hid_t d_id = hdf5_open_matrix_dataset(hdf5_dset.file_id, DM_COLUMN_DATA,
+											  chunk_cache_size);
+
+		column_dset_id.file_id	  = hdf5_dset.file_id;
+		column_dset_id.dataset_id = d_id;
+		column_dset_id.tiles	  = NULL;
+		column_dset_id.dm		  = NULL;
+		hdf5_get_dataset_dimensions(d_id, column_dset_id.dimensions);
+
+		// Read straight from the file if it's contiguous, a column at a time
+		hdf5_map_dataset(&column_dset_id, false);
+
+		// Chunked datasets may be compressed
+		double dm_size = column_dset_id.dimensions[0]
+			* column_dset_id.dimensions[1] * sizeof(word_t) / (1024.0 * 1024);
+		double stored_size
+			= H5Dget_storage_size(column_dset_id.dataset_id) / (1024.0 * 1024);
+
+		// Open the line dataset, if the matrix isn't stored only by columns
+		if (hdf5_dataset_exists(hdf5_dset.file_id, DM_LINE_DATA))
+		{
+			d_id = hdf5_open_matrix_dataset(hdf5_dset.file_id, DM_LINE_DATA,
+											chunk_cache_size);
+
+			line_dset_id.file_id	= hdf5_dset.file_id;
+			line_dset_id.dataset_id = d_id;
+			line_dset_id.tiles		= NULL;
+			line_dset_id.dm			= NULL;
+			hdf5_get_dataset_dimensions(d_id, line_dset_id.dimensions);
+
+			// The lines are read in order
+			hdf5_map_dataset(&line_dset_id, true);
+
+			dm_size += line_dset_id.dimensions[0] * line_dset_id.dimensions[1]
+				* sizeof(word_t) / (1024.0 * 1024);
+			stored_size += H5Dget_storage_size(d_id) / (1024.0 * 1024);
+		}
+		else
+		{
+			hdf5_init_line_tiles(&column_dset_id, &line_dset_id);
+
+			printf("  Lines read from the column tiles\n");
+		}
+
+		printf("  Disjoint matrix stored in %3.2fMB of %3.2fMB\n", stored_size,
+			   dm_size);
+
+		/**
+		 * If we skipped the matriz generation, dataset and dm are empty.
+		 * So we need to read the attributes from the dataset
+		 */
+		hdf5_read_attribute(line_dset_id.dataset_id, N_MATRIX_LINES_ATTR,
+							H5T_NATIVE_UINT64, &cover.n_matrix_lines);
+		hdf5_read_attribute(line_dset_id.dataset_id, N_ATTRIBUTES_ATTR,
+							H5T_NATIVE_UINT32, &cover.n_attributes);
+	}
 
 	cover.n_words_in_a_line = line_dset_id.dimensions[1];
+	if (line_dset_id.tiles != NULL)
+	{
+		cover.n_words_in_a_line = line_dset_id.tiles->n_words;
+	}
 
 	cover.n_words_in_a_column = cover.n_matrix_lines / WORD_BITS
 		+ (cover.n_matrix_lines % WORD_BITS != 0);
 
+	// No line is covered so far
+	cover.n_uncovered_lines = cover.n_matrix_lines;
+
+	/**
+	 * Total number of lines, over all the processes
+	 */
+	const uint64_t n_total_lines = cover.n_matrix_lines;
+
+	if (mpi_size > 1)
+	{
+		/**
+		 * Keep only our slice of the lines, in whole words of the columns.
+		 * The number of uncovered lines is still the global one.
+		 */
+		uint64_t from = 0;
+		uint64_t to	  = 0;
+		get_thread_lines(&cover, mpi_rank, mpi_size, &from, &to);
+
+		cover.first_line		  = from;
+		cover.n_matrix_lines	  = to - from;
+		cover.n_words_in_a_column = cover.n_matrix_lines / WORD_BITS
+			+ (cover.n_matrix_lines % WORD_BITS != 0);
+	}
+
+	/**
+	 * What was read so far is the dataset and the observations, only what
+	 * is read from here on comes from the disjoint matrix
+	 */
+	io_stats_t setup_stats;
+	hdf5_get_io_stats(&setup_stats);
+
+	// Load the matrix if it fits in the memory budget
+	if (line_data == NULL)
+	{
+		line_data = alloc_in_memory_dm(
+			cover.n_matrix_lines, cover.n_words_in_a_line, &memory_budget);
+		if (line_data != NULL)
+		{
+			hdf5_read_lines(&line_dset_id, cover.first_line,
+							cover.n_words_in_a_line, cover.n_matrix_lines,
+							line_data);
+		}
+	}
+
+	// A generated matrix has no column dataset to load it from
+	if (column_data == NULL && !args.virtual_matrix)
+	{
+		column_data = alloc_in_memory_dm(
+			cover.n_attributes, cover.n_words_in_a_column, &memory_budget);
+		if (column_data != NULL)
+		{
+			hsize_t offset[2] = { 0, cover.first_line / WORD_BITS };
+			hsize_t count[2]
+				= { cover.n_attributes, cover.n_words_in_a_column };
+
+			hdf5_read_words(&column_dset_id, offset, count, column_data);
+		}
+	}
+
+	if (line_data != NULL)
+	{
+		printf("  Line matrix kept in memory\n");
+	}
+
+	if (column_data != NULL)
+	{
+		printf("  Column matrix kept in memory\n");
+	}
+
+	/**
+	 * The columns as the lines they cover, read instead of the column
+	 * dataset if they're stored
+	 */
+	sparse_columns_t sparse_columns;
+	sparse_column_t sparse_column;
+	init_sparse_column(&sparse_column);
+
+	bool use_sparse_columns = column_data == NULL && !args.virtual_matrix
+		&& hdf5_dataset_exists(hdf5_dset.file_id, DM_SPARSE_COLUMNS);
+
+	if (use_sparse_columns)
+	{
+		open_sparse_columns(hdf5_dset.file_id, &sparse_columns);
+
+		printf("  Columns read from the sparse columns\n");
+	}
+
 	// The covered lines
 	cover.covered_lines
 		= (word_t*) calloc(cover.n_words_in_a_column, sizeof(word_t));
 
 	// The sum for the attributes
-	cover.attribute_totals = (uint32_t*) calloc(
-		cover.n_words_in_a_line * WORD_BITS, sizeof(uint32_t));
+	cover.attribute_totals = (uint64_t*) calloc(
+		cover.n_words_in_a_line * WORD_BITS, sizeof(uint64_t));
 
 	/**
 	 * Column data to process
@@ -336,25 +820,79 @@ apply_set_cover:
 	/**
 	 * Number of uncovered lines.
 	 */
-	// uint32_t n_uncovered_lines = 0;
+	// uint64_t n_uncovered_lines = 0;
 
 	cover.selected_attributes
 		= (word_t*) calloc(cover.n_words_in_a_line, sizeof(word_t));
 
 	read_initial_attribute_totals(hdf5_dset.file_id, cover.attribute_totals);
 
-	// No line is covered so far
-	cover.n_uncovered_lines = cover.n_matrix_lines;
+	/**
+	 * The totals updated by this process, for its own lines only.
+	 * Their sum over all processes is the global attribute totals.
+	 */
+	uint64_t* global_totals = cover.attribute_totals;
+	uint64_t* local_totals	= cover.attribute_totals;
+
+	if (mpi_size > 1)
+	{
+		local_totals = (uint64_t*) calloc(cover.n_words_in_a_line * WORD_BITS,
+										  sizeof(uint64_t));
+		assert(local_totals != NULL);
+
+		// The first process starts with the full totals, the others with 0
+		if (mpi_rank == 0)
+		{
+			memcpy(local_totals, global_totals,
+				   cover.n_attributes * sizeof(uint64_t));
+		}
+	}
+
+	/**
+	 * Upper bounds of the attribute totals, for the lazy greedy selection
+	 */
+	heap_t heap;
+	if (args.lazy)
+	{
+		init_heap(&heap, cover.attribute_totals, cover.n_attributes);
+	}
+
+	/**
+	 * Compact copy of the uncovered lines, once there are only a few left
+	 */
+	working_set_t working_set;
+	init_working_set(&working_set);
+
+	/**
+	 * Chooses how the attribute totals are updated
+	 */
+	strategy_selector_t selector;
+	init_strategy_selector(&selector, args.auto_strategy, args.column_totals,
+						   line_data != NULL, column_data != NULL,
+						   args.virtual_matrix);
 
 	while (true)
 	{
 		int64_t best_attribute = 0;
 
-		best_attribute = get_best_attribute_index(cover.attribute_totals,
-												  cover.n_attributes);
+		// The column of the best attribute
+		const word_t* best_column = column;
+
+		if (args.lazy)
+		{
+			best_attribute = get_best_attribute_index_lazy(
+				&cover, &heap, &column_dset_id, column_data,
+				use_sparse_columns ? &sparse_columns : NULL, &sparse_column,
+				column, &best_column);
+		}
+		else
+		{
+			best_attribute = get_best_attribute_index(cover.attribute_totals,
+													  cover.n_attributes);
+		}
 
 		printf("  Selected attribute #%ld, ", best_attribute);
-		printf("covers %d lines ", cover.attribute_totals[best_attribute]);
+		printf("covers %lu lines ", cover.attribute_totals[best_attribute]);
 		TOCK;
 		TICK;
 
@@ -369,57 +907,277 @@ apply_set_cover:
 			break;
 		}
 
+		// Get the column data for the best attribute
+		if (column_data != NULL)
+		{
+			best_column = column_data
+				+ (uint64_t) best_attribute * cover.n_words_in_a_column;
+		}
+		else if (use_sparse_columns)
+		{
+			// The lazy selection already left it in sparse_column
+			if (!args.lazy)
+			{
+				read_sparse_column(&sparse_columns, best_attribute,
+								   &sparse_column);
+			}
+		}
+		else if (!args.lazy)
+		{
+			// The lazy selection already left it in best_column
+			best_column = get_column(&column_dset_id, best_attribute,
+									 cover.first_line / WORD_BITS,
+									 cover.n_words_in_a_column, column);
+		}
+
+		if (args.lazy)
+		{
+			// The totals are refreshed on demand by the lazy selection
+			if (use_sparse_columns)
+			{
+				update_covered_lines_sparse(&cover, &sparse_column);
+			}
+			else
+			{
+				update_covered_lines(&cover, best_column);
+			}
+			continue;
+		}
+
+		if (cover.n_uncovered_lines * 100 < n_total_lines * args.working_set)
+		{
+			if (working_set.lines == NULL)
+			{
+				// Copy the uncovered lines to the working set
+				if (line_data != NULL)
+				{
+					build_working_set_mem(&working_set, &cover, line_data);
+				}
+				else
+				{
+					build_working_set(&working_set, &cover, &line_dset_id);
+				}
+
+				printf("  Working set with %lu lines ", working_set.n_lines);
+				TOCK;
+				TICK;
+			}
+			else if (cover.n_uncovered_lines
+					 < working_set.n_uncovered_lines / 2)
+			{
+				// Most of the working set is covered, drop those lines
+				compact_working_set(&working_set, &cover);
+			}
+		}
+
 		/**
-		 * If this attribute covers more lines than what remains
-		 * to be covered we calculate the sum of the remaining lines.
-		 * If the attribute covers only a few lines we remove the
-		 * contribution of the covered lines.
-		 * The objetive is to reduce the number of lines read
-		 * from the dataset.
+		 * Choose how to update the totals, either recalculating them from
+		 * the remaining uncovered lines or removing the contribution of
+		 * the newly covered lines.
+		 * The objetive is to reduce the data read from the dataset.
 		 */
-		oknok_t sum_uncovered_lines = NOK;
-		if (cover.attribute_totals[best_attribute] > cover.n_uncovered_lines)
+		strategy_t strategy
+			= select_strategy(&selector, &cover, &working_set,
+							  cover.attribute_totals[best_attribute]);
+
+#ifdef USE_MPI
+		if (mpi_size > 1)
+		{
+			// The partial totals are only consistent if we all agree
+			int strategy_id = strategy;
+			MPI_Bcast(&strategy_id, 1, MPI_INT, 0, MPI_COMM_WORLD);
+			strategy = (strategy_t) strategy_id;
+		}
+#endif
+
+		if (args.auto_strategy)
 		{
-			// We'll check the uncovered lines
-			sum_uncovered_lines = OK;
+			print_strategy(stdout, &selector, strategy);
 		}
 
-		// Read the column data for the best attribute
-		get_column(column_dset_id.dataset_id, best_attribute,
-				   cover.n_words_in_a_column, column);
+		bool subtract = strategy == STRATEGY_LINES_SUB
+			|| strategy == STRATEGY_COLUMNS_SUB
+			|| strategy == STRATEGY_WORKING_SET_SUB;
+
+		double strategy_start = omp_get_wtime();
+
+		// Update the totals of our own lines
+		cover.attribute_totals = local_totals;
 
-		if (sum_uncovered_lines == OK)
+		if (subtract && use_sparse_columns)
 		{
-			// Update covered lines array
-			update_covered_lines(&cover, column);
+			// Only the updates that subtract need the whole column
+			sparse_column_to_dense(&cover, &sparse_column, column);
+		}
 
-			// Calculate the totals for all the attributes
-			// for the remaining uncovered lines
-			update_attribute_totals_add(&cover, &line_dset_id);
+		if (!subtract)
+		{
+			// Update covered lines array before recalculating the totals
+			if (use_sparse_columns)
+			{
+				update_covered_lines_sparse(&cover, &sparse_column);
+			}
+			else
+			{
+				update_covered_lines(&cover, best_column);
+			}
 		}
-		else
+
+		switch (strategy)
 		{
-			// Remove contribution from newly covered lines
-			update_attribute_totals_sub(&cover, &line_dset_id, column);
+			case STRATEGY_LINES_ADD:
+				if (line_data != NULL)
+				{
+					update_attribute_totals_add_mem(&cover, line_data);
+				}
+				else
+				{
+					update_attribute_totals_add(&cover, &line_dset_id,
+												args.block_size);
+				}
+				break;
+			case STRATEGY_LINES_SUB:
+				if (line_data != NULL)
+				{
+					update_attribute_totals_sub_mem(&cover, line_data,
+													best_column);
+				}
+				else
+				{
+					update_attribute_totals_sub(&cover, &line_dset_id,
+												best_column, args.block_size);
+				}
+				break;
+			case STRATEGY_COLUMNS_ADD:
+				if (column_data != NULL)
+				{
+					update_attribute_totals_add_columns_mem(&cover,
+															column_data);
+				}
+				else
+				{
+					update_attribute_totals_add_columns(&cover, &column_dset_id,
+														args.block_size);
+				}
+				break;
+			case STRATEGY_COLUMNS_SUB:
+				if (column_data != NULL)
+				{
+					update_attribute_totals_sub_columns_mem(
+						&cover, column_data, best_column);
+				}
+				else
+				{
+					update_attribute_totals_sub_columns(
+						&cover, &column_dset_id, best_column, args.block_size);
+				}
+				break;
+			case STRATEGY_WORKING_SET_ADD:
+				update_attribute_totals_add_ws(&cover, &working_set);
+				break;
+			case STRATEGY_WORKING_SET_SUB:
+				update_attribute_totals_sub_ws(&cover, &working_set,
+											   best_column);
+				break;
+			default:
+				break;
+		}
 
-			// Update covered lines array
-			update_covered_lines(&cover, column);
+		if (subtract)
+		{
+			// Update covered lines array after removing their contribution
+			if (use_sparse_columns)
+			{
+				update_covered_lines_sparse(&cover, &sparse_column);
+			}
+			else
+			{
+				update_covered_lines(&cover, best_column);
+			}
 		}
+
+		record_strategy_time(&selector, strategy,
+							 omp_get_wtime() - strategy_start);
+
+		cover.attribute_totals = global_totals;
+
+#ifdef USE_MPI
+		if (mpi_size > 1)
+		{
+			// Sum the totals of all the processes
+			MPI_Allreduce(local_totals, global_totals, cover.n_attributes,
+						  MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+		}
+#endif
 	}
 
 	print_solution(stdout, &cover);
+
+	io_stats_t read_stats;
+	hdf5_get_io_stats(&read_stats);
+
+	read_stats.bytes_read -= setup_stats.bytes_read;
+	read_stats.read_time -= setup_stats.read_time;
+
+	if (read_stats.bytes_read > 0)
+	{
+		printf("Read %3.2fMB of the disjoint matrix in %3.2fs (%3.2fMB/s)\n",
+			   read_stats.bytes_read / (1024.0 * 1024), read_stats.read_time,
+			   read_stats.bytes_read / (1024.0 * 1024) / read_stats.read_time);
+	}
+
 	printf("All done! ");
 
 	PRINT_TIMING_GLOBAL;
 
+	if (args.lazy)
+	{
+		free_heap(&heap);
+	}
+
+	free_working_set(&working_set);
+
+	if (use_sparse_columns)
+	{
+		close_sparse_columns(&sparse_columns);
+	}
+	free_sparse_column(&sparse_column);
+
+	if (local_totals != global_totals)
+	{
+		free(local_totals);
+	}
+	local_totals = NULL;
+
 	free(column);
 	column = NULL;
+	free(line_data);
+	line_data = NULL;
+	free(column_data);
+	column_data = NULL;
 	free_cover(&cover);
 
+	// The observations of a generated matrix
+	free_dataset(&dataset);
+
 	// Close dataset files
-	H5Dclose(line_dset_id.dataset_id);
-	H5Dclose(column_dset_id.dataset_id);
+	if (!args.virtual_matrix)
+	{
+		// The tiles share the mapping of the columns
+		if (line_dset_id.tiles == NULL)
+		{
+			hdf5_unmap_dataset(&line_dset_id);
+			H5Dclose(line_dset_id.dataset_id);
+		}
+		hdf5_free_line_tiles(&line_dset_id);
+		hdf5_unmap_dataset(&column_dset_id);
+		H5Dclose(column_dset_id.dataset_id);
+	}
 	H5Fclose(hdf5_dset.file_id);
 
+#ifdef USE_MPI
+	MPI_Finalize();
+#endif
+
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,332 @@
+/*
+ ============================================================================
+ Name        : partition.c
+ Author      : Eduardo Ribeiro
+ Description : Set cover without the disjoint matrix.
+			   A matrix line (p, q) is uncovered while the observations p
+			   and q, from different classes, agree on all the selected
+			   attributes. So the uncovered lines are described by the
+			   partition of the observations by their values on the
+			   selected attributes, which is refined after each selection
+ ============================================================================
+ */
+
+#include "partition.h"
+
+#include "set_cover.h"
+#include "types/bit_counters_t.h"
+#include "types/cover_t.h"
+#include "types/dataset_t.h"
+#include "types/oknok_t.h"
+#include "types/partition_t.h"
+#include "types/word_t.h"
+#include "utils/bit.h"
+#include "utils/bit_counters.h"
+
+#include <assert.h>
+#include <omp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Below this number of observations the bits are counted one by one,
+ * it's not worth going through the bit counters
+ */
+#define PARTITION_MIN_BIT_COUNTERS 16
+
+oknok_t init_partition(partition_t* partition, const dataset_t* dataset)
+{
+	partition->n_words = dataset->n_words;
+
+	// Observations, block starts and buffers to refine into
+	partition->observations
+		= (word_t**) malloc(dataset->n_observations * sizeof(word_t*));
+	assert(partition->observations != NULL);
+
+	partition->next_observations
+		= (word_t**) malloc(dataset->n_observations * sizeof(word_t*));
+	assert(partition->next_observations != NULL);
+
+	partition->classes
+		= (uint32_t*) malloc(dataset->n_observations * sizeof(uint32_t));
+	assert(partition->classes != NULL);
+
+	partition->next_classes
+		= (uint32_t*) malloc(dataset->n_observations * sizeof(uint32_t));
+	assert(partition->next_classes != NULL);
+
+	partition->block_starts
+		= (uint32_t*) malloc((dataset->n_observations + 1) * sizeof(uint32_t));
+	assert(partition->block_starts != NULL);
+
+	partition->next_block_starts
+		= (uint32_t*) malloc((dataset->n_observations + 1) * sizeof(uint32_t));
+	assert(partition->next_block_starts != NULL);
+
+	// A single block with all the observations, sorted by class
+	uint32_t n = 0;
+	for (uint32_t c = 0; c < dataset->n_classes; c++)
+	{
+		word_t** observations
+			= dataset->observations_per_class + c * dataset->n_observations;
+
+		for (uint32_t o = 0; o < dataset->n_observations_per_class[c]; o++)
+		{
+			partition->observations[n] = observations[o];
+			partition->classes[n]	   = c;
+			n++;
+		}
+	}
+
+	partition->n_observations  = n;
+	partition->n_blocks		   = 0;
+	partition->block_starts[0] = 0;
+
+	if (n > 0 && partition->classes[0] != partition->classes[n - 1])
+	{
+		partition->n_blocks		   = 1;
+		partition->block_starts[1] = n;
+	}
+	else
+	{
+		// A single class, there's nothing to cover
+		partition->n_observations = 0;
+	}
+
+	return OK;
+}
+
+/**
+ * Counts how many of the n_observations have each attribute set.
+ * class_ones must be zeroed and is the totals array of counters
+ */
+static void count_class_ones(bit_counters_t* counters, word_t** observations,
+							 const uint32_t n_observations,
+							 const uint32_t n_words, uint64_t* class_ones)
+{
+	if (n_observations >= PARTITION_MIN_BIT_COUNTERS)
+	{
+		for (uint32_t o = 0; o < n_observations; o++)
+		{
+			bit_counters_add_line(counters, observations[o]);
+		}
+
+		bit_counters_flush(counters);
+
+		return;
+	}
+
+	for (uint32_t o = 0; o < n_observations; o++)
+	{
+		for (uint32_t w = 0; w < n_words; w++)
+		{
+			word_t bits = observations[o][w];
+
+			// Attributes are stored from the most significant bit
+			while (bits != 0)
+			{
+				uint8_t bit = __builtin_ctzl(bits);
+				class_ones[w * WORD_BITS + WORD_BITS - 1 - bit]++;
+				bits &= bits - 1;
+			}
+		}
+	}
+}
+
+oknok_t update_attribute_totals_partition(cover_t* cover,
+										  const partition_t* partition)
+{
+	// Reset totals
+	memset(cover->attribute_totals, 0, cover->n_attributes * sizeof(uint64_t));
+
+	uint32_t n_totals = partition->n_words * WORD_BITS;
+
+	uint32_t max_threads	= omp_get_max_threads();
+	uint64_t** partial_totals
+		= (uint64_t**) calloc(max_threads, sizeof(uint64_t*));
+	assert(partial_totals != NULL);
+
+#pragma omp parallel num_threads(max_threads)
+	{
+		uint32_t thread_id = omp_get_thread_num();
+		uint32_t n_threads = omp_get_num_threads();
+
+		uint64_t* totals = (uint64_t*) calloc(n_totals, sizeof(uint64_t));
+		assert(totals != NULL);
+
+		/**
+		 * Observations with each attribute set, in the current class and
+		 * in the current block
+		 */
+		uint64_t* class_ones = (uint64_t*) calloc(n_totals, sizeof(uint64_t));
+		assert(class_ones != NULL);
+
+		uint64_t* block_ones = (uint64_t*) calloc(n_totals, sizeof(uint64_t));
+		assert(block_ones != NULL);
+
+		/**
+		 * Sum of ones_c * zeros_c over the classes of the current block
+		 */
+		uint64_t* same_class = (uint64_t*) calloc(n_totals, sizeof(uint64_t));
+		assert(same_class != NULL);
+
+		bit_counters_t counters;
+		init_bit_counters(&counters, partition->n_words, class_ones, false);
+
+#pragma omp for schedule(dynamic)
+		for (uint32_t b = 0; b < partition->n_blocks; b++)
+		{
+			uint32_t start = partition->block_starts[b];
+			uint32_t end   = partition->block_starts[b + 1];
+
+			memset(block_ones, 0, cover->n_attributes * sizeof(uint64_t));
+			memset(same_class, 0, cover->n_attributes * sizeof(uint64_t));
+
+			// The observations of each class are together
+			uint32_t class_end = start;
+			for (uint32_t class_start = start; class_start < end;
+				 class_start = class_end)
+			{
+				while (class_end < end
+					   && partition->classes[class_end]
+						   == partition->classes[class_start])
+				{
+					class_end++;
+				}
+
+				uint32_t n_class = class_end - class_start;
+
+				memset(class_ones, 0, n_totals * sizeof(uint64_t));
+				count_class_ones(&counters,
+								 partition->observations + class_start,
+								 n_class, partition->n_words, class_ones);
+
+				for (uint32_t a = 0; a < cover->n_attributes; a++)
+				{
+					uint64_t ones = class_ones[a];
+
+					block_ones[a] += class_ones[a];
+					same_class[a] += ones * (n_class - ones);
+				}
+			}
+
+			/**
+			 * Lines with one observation with the attribute set and the
+			 * other without it, minus those in the same class
+			 */
+			uint64_t n_block = end - start;
+			for (uint32_t a = 0; a < cover->n_attributes; a++)
+			{
+				uint64_t ones = block_ones[a];
+
+				totals[a] += ones * (n_block - ones) - same_class[a];
+			}
+		}
+
+		free_bit_counters(&counters);
+		free(class_ones);
+		free(block_ones);
+		free(same_class);
+
+		partial_totals[thread_id] = totals;
+
+#pragma omp barrier
+
+		reduce_attribute_totals(cover, partial_totals, n_threads, false);
+
+		free(totals);
+	}
+
+	free(partial_totals);
+
+	return OK;
+}
+
+oknok_t refine_partition(partition_t* partition, const uint32_t attribute)
+{
+	uint32_t attribute_word = attribute / WORD_BITS;
+	uint8_t attribute_bit	= WORD_BITS - (attribute % WORD_BITS) - 1;
+
+	uint32_t n		  = 0;
+	uint32_t n_blocks = 0;
+
+	for (uint32_t b = 0; b < partition->n_blocks; b++)
+	{
+		uint32_t start = partition->block_starts[b];
+		uint32_t end   = partition->block_starts[b + 1];
+
+		// First the observations without the attribute, then the others,
+		// keeping the class order
+		for (uint8_t value = 0; value < 2; value++)
+		{
+			uint32_t first = n;
+
+			for (uint32_t o = start; o < end; o++)
+			{
+				word_t* observation = partition->observations[o];
+
+				if (BIT_CHECK(observation[attribute_word], attribute_bit)
+					== value)
+				{
+					partition->next_observations[n] = observation;
+					partition->next_classes[n]		= partition->classes[o];
+					n++;
+				}
+			}
+
+			if (n > first
+				&& partition->next_classes[first]
+					!= partition->next_classes[n - 1])
+			{
+				partition->next_block_starts[n_blocks++] = first;
+			}
+			else
+			{
+				// A single class, all its lines are covered
+				n = first;
+			}
+		}
+	}
+
+	partition->next_block_starts[n_blocks] = n;
+
+	// Swap buffers
+	word_t** observations		  = partition->observations;
+	partition->observations		 = partition->next_observations;
+	partition->next_observations = observations;
+
+	uint32_t* classes		 = partition->classes;
+	partition->classes		= partition->next_classes;
+	partition->next_classes = classes;
+
+	uint32_t* block_starts			= partition->block_starts;
+	partition->block_starts		 = partition->next_block_starts;
+	partition->next_block_starts = block_starts;
+
+	partition->n_observations = n;
+	partition->n_blocks		  = n_blocks;
+
+	return OK;
+}
+
+void free_partition(partition_t* partition)
+{
+	free(partition->observations);
+	free(partition->next_observations);
+	free(partition->classes);
+	free(partition->next_classes);
+	free(partition->block_starts);
+	free(partition->next_block_starts);
+
+	partition->observations		 = NULL;
+	partition->next_observations = NULL;
+	partition->classes			 = NULL;
+	partition->next_classes		 = NULL;
+	partition->block_starts		 = NULL;
+	partition->next_block_starts = NULL;
+
+	partition->n_observations = 0;
+	partition->n_blocks		  = 0;
+}
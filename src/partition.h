@@ -0,0 +1,48 @@
+/*
+ ============================================================================
+ Name        : partition.h
+ Author      : Eduardo Ribeiro
+ Description : Set cover without the disjoint matrix.
+			   A matrix line (p, q) is uncovered while the observations p
+			   and q, from different classes, agree on all the selected
+			   attributes. So the uncovered lines are described by the
+			   partition of the observations by their values on the
+			   selected attributes, which is refined after each selection
+ ============================================================================
+ */
+
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "types/cover_t.h"
+#include "types/dataset_t.h"
+#include "types/oknok_t.h"
+#include "types/partition_t.h"
+
+#include <stdint.h>
+
+/**
+ * Builds the initial partition: a single block with all the observations
+ */
+oknok_t init_partition(partition_t* partition, const dataset_t* dataset);
+
+/**
+ * Calculates the attribute totals for the uncovered lines.
+ * In each block, the lines covered by attribute a are
+ * ones[a] * zeros[a] - sum(ones_c[a] * zeros_c[a]) for each class c
+ */
+oknok_t update_attribute_totals_partition(cover_t* cover,
+										  const partition_t* partition);
+
+/**
+ * Splits every block by the value of attribute.
+ * The blocks with a single class are dropped
+ */
+oknok_t refine_partition(partition_t* partition, const uint32_t attribute);
+
+/**
+ * Frees the allocated resources
+ */
+void free_partition(partition_t* partition);
+
+#endif // PARTITION_H
@@ -14,22 +14,26 @@
 #include "types/oknok_t.h"
 #include "types/word_t.h"
 #include "utils/bit.h"
+#include "utils/bit_counters.h"
 #include "utils/timing.h"
 
 #include "hdf5.h"
 
 #include <assert.h>
+#include <omp.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
-oknok_t read_initial_attribute_totals(hid_t file_id, uint32_t* attribute_totals)
+oknok_t read_initial_attribute_totals(hid_t file_id, uint64_t* attribute_totals)
 {
 	// Open dataset
 	hid_t dset_id = H5Dopen(file_id, DM_ATTRIBUTE_TOTALS, H5P_DEFAULT);
 	assert(dset_id != NOK);
 
-	// Read attribute totals
-	herr_t status = H5Dread(dset_id, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL,
+	// Read attribute totals, older files store them with 32 bits
+	herr_t status = H5Dread(dset_id, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL,
 							H5P_DEFAULT, attribute_totals);
 	assert(status != NOK);
 
@@ -39,10 +43,10 @@ oknok_t read_initial_attribute_totals(hid_t file_id, uint32_t* attribute_totals)
 	return OK;
 }
 
-int64_t get_best_attribute_index(const uint32_t* totals,
+int64_t get_best_attribute_index(const uint64_t* totals,
 								 const uint32_t n_attributes)
 {
-	uint32_t max_total	  = 0;
+	uint64_t max_total	  = 0;
 	int64_t max_attribute = -1;
 
 	for (uint32_t i = 0; i < n_attributes; i++)
@@ -57,49 +61,328 @@ int64_t get_best_attribute_index(const uint32_t* totals,
 	return max_attribute;
 }
 
-oknok_t add_line_contribution(cover_t* cover, const word_t* line)
+/**
+ * Returns the word w of the lines to process bit array
+ */
+static inline word_t get_lines_to_process(const cover_t* cover,
+										  const word_t* column,
+										  const uint64_t w)
+{
+	if (column == NULL)
+	{
+		return ~cover->covered_lines[w];
+	}
+
+	// cov col
+	//   0   0   0
+	//   0   1   1
+	//   1   0   0
+	//   1   1   0
+	return ~cover->covered_lines[w] & column[w];
+}
+
+uint64_t get_next_line_run(const cover_t* cover, const word_t* column,
+						   const uint64_t from, const uint64_t to,
+						   uint64_t* start)
+{
+	uint64_t line = from;
+
+	// Find the first line to process
+	while (line < to)
+	{
+		uint8_t bit	  = line % WORD_BITS;
+		word_t values = get_lines_to_process(cover, column, line / WORD_BITS)
+			<< bit;
+
+		if (values == 0)
+		{
+			// Nothing to process on the rest of this word
+			line += WORD_BITS - bit;
+			continue;
+		}
+
+		line += __builtin_clzl(values);
+		break;
+	}
+
+	if (line >= to)
+	{
+		return 0;
+	}
+
+	*start = line;
+
+	// Find the end of the run
+	while (line < to)
+	{
+		uint8_t bit	  = line % WORD_BITS;
+		word_t values = ~(get_lines_to_process(cover, column, line / WORD_BITS)
+						  << bit);
+
+		if (values == 0)
+		{
+			// The run continues to the next word
+			line += WORD_BITS;
+			continue;
+		}
+
+		// The shifted in bits are set, so we never go past the word end
+		uint8_t n_bits = __builtin_clzl(values);
+		line += n_bits;
+
+		if (n_bits < WORD_BITS - bit)
+		{
+			// The run ends on this word
+			break;
+		}
+	}
+
+	if (line > to)
+	{
+		line = to;
+	}
+
+	return line - *start;
+}
+
+void get_thread_lines(const cover_t* cover, const uint32_t thread_id,
+					  const uint32_t n_threads, uint64_t* from, uint64_t* to)
+{
+	// Each thread gets whole words of the covered lines array
+	uint64_t n_words = cover->n_words_in_a_column / n_threads;
+	uint64_t extra	 = cover->n_words_in_a_column % n_threads;
+
+	uint64_t first_word = thread_id * n_words
+		+ (thread_id < extra ? thread_id : extra);
+	uint64_t last_word = first_word + n_words + (thread_id < extra);
+
+	*from = first_word * WORD_BITS;
+	*to	  = last_word * WORD_BITS;
+
+	if (*to > cover->n_matrix_lines)
+	{
+		*to = cover->n_matrix_lines;
+	}
+
+	if (*from > *to)
+	{
+		*from = *to;
+	}
+}
+
+void reduce_attribute_totals(cover_t* cover, uint64_t** partial_totals,
+							 const uint32_t n_threads, const bool subtract)
+{
+#pragma omp for schedule(static)
+	for (uint32_t a = 0; a < cover->n_attributes; a++)
+	{
+		uint64_t total = 0;
+		for (uint32_t t = 0; t < n_threads; t++)
+		{
+			total += partial_totals[t][a];
+		}
+
+		if (subtract)
+		{
+			cover->attribute_totals[a] -= total;
+		}
+		else
+		{
+			cover->attribute_totals[a] += total;
+		}
+	}
+}
+
+/**
+ * Adds (or subtracts) the contribution of the lines to process to the
+ * attribute totals, using the disjoint matrix stored in memory.
+ * Each thread processes its own range of lines into private totals,
+ * which are then reduced into the attribute totals
+ */
+static oknok_t update_attribute_totals_mem(cover_t* cover,
+										   const word_t* line_data,
+										   const word_t* column,
+										   const bool subtract)
 {
-	/**
-	 * Current attribute
-	 */
-	uint32_t c_attribute = 0;
+	uint32_t max_threads	= omp_get_max_threads();
+	uint64_t** partial_totals
+		= (uint64_t**) calloc(max_threads, sizeof(uint64_t*));
+	assert(partial_totals != NULL);
 
-	// Process words
-	for (uint32_t c_word = 0; c_word < cover->n_words_in_a_line; c_word++)
+#pragma omp parallel num_threads(max_threads)
 	{
-		for (int8_t bit = WORD_BITS - 1; bit >= 0; bit--, c_attribute++)
+		uint32_t thread_id = omp_get_thread_num();
+		uint32_t n_threads = omp_get_num_threads();
+
+		uint64_t current_line = 0;
+		uint64_t end_line	  = 0;
+		get_thread_lines(cover, thread_id, n_threads, &current_line,
+						 &end_line);
+
+		uint64_t* totals = (uint64_t*) calloc(
+			cover->n_words_in_a_line * WORD_BITS, sizeof(uint64_t));
+		assert(totals != NULL);
+
+		bit_counters_t counters;
+		init_bit_counters(&counters, cover->n_words_in_a_line, totals, false);
+
+		uint64_t start	 = 0;
+		uint64_t n_lines = 0;
+		while ((n_lines = get_next_line_run(cover, column, current_line,
+											end_line, &start))
+			   > 0)
 		{
-			cover->attribute_totals[c_attribute]
-				+= BIT_CHECK(line[c_word], bit);
+			const word_t* line = line_data + start * cover->n_words_in_a_line;
+
+			for (uint64_t l = 0; l < n_lines; l++)
+			{
+				bit_counters_add_line(&counters, line);
+				line += cover->n_words_in_a_line;
+			}
+
+			current_line = start + n_lines;
 		}
+
+		bit_counters_flush(&counters);
+		free_bit_counters(&counters);
+
+		partial_totals[thread_id] = totals;
+
+#pragma omp barrier
+
+		reduce_attribute_totals(cover, partial_totals, n_threads, subtract);
+
+		free(totals);
 	}
 
+	free(partial_totals);
+
 	return OK;
 }
 
-oknok_t sub_line_contribution(cover_t* cover, const word_t* line)
+oknok_t update_attribute_totals_add_mem(cover_t* cover,
+										const word_t* line_data)
+{
+	// Reset totals
+	memset(cover->attribute_totals, 0, cover->n_attributes * sizeof(uint64_t));
+
+	return update_attribute_totals_mem(cover, line_data, NULL, false);
+}
+
+oknok_t update_attribute_totals_sub_mem(cover_t* cover,
+										const word_t* line_data,
+										const word_t* column)
+{
+	return update_attribute_totals_mem(cover, line_data, column, true);
+}
+
+uint64_t get_column_coverage(const cover_t* cover, const word_t* column)
 {
-	/**
-	 * Current attribute
-	 */
-	uint32_t c_attribute = 0;
+	uint64_t total = 0;
 
-	// Process full words
-	for (uint32_t c_word = 0; c_word < cover->n_words_in_a_line; c_word++)
+	for (uint64_t w = 0; w < cover->n_words_in_a_column; w++)
 	{
-		for (int8_t bit = WORD_BITS - 1; bit >= 0; bit--, c_attribute++)
+		total += __builtin_popcountl(column[w] & ~cover->covered_lines[w]);
+	}
+
+	return total;
+}
+
+uint64_t get_column_mask(const cover_t* cover, const word_t* column,
+						 word_t* mask, uint64_t* words)
+{
+	uint64_t n_mask_words = 0;
+
+	for (uint64_t w = 0; w < cover->n_words_in_a_column; w++)
+	{
+		mask[w] = get_lines_to_process(cover, column, w);
+
+		if (mask[w] != 0)
 		{
-			cover->attribute_totals[c_attribute]
-				-= BIT_CHECK(line[c_word], bit);
+			words[n_mask_words++] = w;
 		}
 	}
 
+	return n_mask_words;
+}
+
+oknok_t update_attribute_totals_columns(cover_t* cover, const word_t* columns,
+										const uint32_t first_attribute,
+										const uint32_t n_columns,
+										const word_t* mask,
+										const uint64_t* words,
+										const uint64_t n_mask_words,
+										const bool subtract)
+{
+	// Every attribute is independent of the others
+#pragma omp parallel for schedule(static)
+	for (uint32_t c = 0; c < n_columns; c++)
+	{
+		const word_t* column = columns + c * cover->n_words_in_a_column;
+
+		uint64_t total = 0;
+		for (uint64_t i = 0; i < n_mask_words; i++)
+		{
+			total += __builtin_popcountl(column[words[i]] & mask[words[i]]);
+		}
+
+		if (subtract)
+		{
+			cover->attribute_totals[first_attribute + c] -= total;
+		}
+		else
+		{
+			cover->attribute_totals[first_attribute + c] = total;
+		}
+	}
+
+	return OK;
+}
+
+oknok_t update_attribute_totals_add_columns_mem(cover_t* cover,
+												const word_t* column_data)
+{
+	word_t* mask
+		= (word_t*) malloc(cover->n_words_in_a_column * sizeof(word_t));
+	uint64_t* words
+		= (uint64_t*) malloc(cover->n_words_in_a_column * sizeof(uint64_t));
+	assert(mask != NULL && words != NULL);
+
+	uint64_t n_mask_words = get_column_mask(cover, NULL, mask, words);
+
+	update_attribute_totals_columns(cover, column_data, 0, cover->n_attributes,
+									mask, words, n_mask_words, false);
+
+	free(words);
+	free(mask);
+
+	return OK;
+}
+
+oknok_t update_attribute_totals_sub_columns_mem(cover_t* cover,
+												const word_t* column_data,
+												const word_t* column)
+{
+	word_t* mask
+		= (word_t*) malloc(cover->n_words_in_a_column * sizeof(word_t));
+	uint64_t* words
+		= (uint64_t*) malloc(cover->n_words_in_a_column * sizeof(uint64_t));
+	assert(mask != NULL && words != NULL);
+
+	uint64_t n_mask_words = get_column_mask(cover, column, mask, words);
+
+	update_attribute_totals_columns(cover, column_data, 0, cover->n_attributes,
+									mask, words, n_mask_words, true);
+
+	free(words);
+	free(mask);
+
 	return OK;
 }
 
-oknok_t update_covered_lines(cover_t* cover, word_t* column)
+oknok_t update_covered_lines(cover_t* cover, const word_t* column)
 {
-	for (uint32_t w = 0; w < cover->n_words_in_a_column; w++)
+	for (uint64_t w = 0; w < cover->n_words_in_a_column; w++)
 	{
 		BITMASK_SET(cover->covered_lines[w], column[w]);
 	}
@@ -148,6 +431,7 @@ void free_cover(cover_t* cover)
 {
 	cover->n_attributes		   = 0;
 	cover->n_matrix_lines	   = 0;
+	cover->first_line		   = 0;
 	cover->n_words_in_a_line   = 0;
 	cover->n_words_in_a_column = 0;
 
@@ -164,6 +448,7 @@ void init_cover(cover_t* cover)
 {
 	cover->n_attributes		   = 0;
 	cover->n_matrix_lines	   = 0;
+	cover->first_line		   = 0;
 	cover->n_words_in_a_line   = 0;
 	cover->n_words_in_a_column = 0;
 	cover->covered_lines	   = NULL;
@@ -16,20 +16,21 @@
 
 #include "hdf5.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
  * reads initial attribute totals from metadata dataset
  */
 oknok_t read_initial_attribute_totals(hid_t file_id,
-									  uint32_t* attribute_totals);
+									  uint64_t* attribute_totals);
 
 /**
  * Searches the attribute totals array for the highest score and returns the
  * correspondent attribute index.
  * Returns -1 if there are no more attributes available.
  */
-int64_t get_best_attribute_index(const uint32_t* totals,
+int64_t get_best_attribute_index(const uint64_t* totals,
 								 const uint32_t n_attributes);
 
 /**
@@ -38,21 +39,96 @@ int64_t get_best_attribute_index(const uint32_t* totals,
 oknok_t mark_attribute_as_selected(cover_t* cover, int64_t attribute);
 
 /**
- * Updates the contribution of this line to the attributes totals
- * Assumes the attributes totals array length is a multiple of WORD_BITS
+ * Searches for the next run of consecutive lines that need to be processed,
+ * between lines from and to (exclusive).
+ * If column is NULL we want the uncovered lines, otherwise we want the
+ * uncovered lines that are covered by column.
+ * Stores the first line of the run in start and returns the run length, or 0
+ * if there are no more lines to process.
  */
-oknok_t add_line_contribution(cover_t* cover, const word_t* line);
+uint64_t get_next_line_run(const cover_t* cover, const word_t* column,
+						   const uint64_t from, const uint64_t to,
+						   uint64_t* start);
 
 /**
- * Updates the contribution of this line to the attributes totals
- * Assumes the attributes totals array length is a multiple of WORD_BITS
+ * Returns the number of uncovered lines covered by this column
  */
-oknok_t sub_line_contribution(cover_t* cover, const word_t* line);
+uint64_t get_column_coverage(const cover_t* cover, const word_t* column);
+
+/**
+ * Splits the matrix lines between n_threads, in whole words of the covered
+ * lines array, and stores the range [from, to) of thread_id
+ */
+void get_thread_lines(const cover_t* cover, const uint32_t thread_id,
+					  const uint32_t n_threads, uint64_t* from, uint64_t* to);
+
+/**
+ * Adds (or subtracts) the partial totals calculated by n_threads threads to
+ * the attribute totals.
+ * Must be called by all the threads of the team
+ */
+void reduce_attribute_totals(cover_t* cover, uint64_t** partial_totals,
+							 const uint32_t n_threads, const bool subtract);
+
+/**
+ * Calculates the attribute totals for the uncovered lines, using the
+ * disjoint matrix stored in memory
+ */
+oknok_t update_attribute_totals_add_mem(cover_t* cover,
+										const word_t* line_data);
+
+/**
+ * Removes the contribution of the lines that are about to be covered by
+ * column from the attribute totals, using the disjoint matrix stored in memory
+ */
+oknok_t update_attribute_totals_sub_mem(cover_t* cover,
+										const word_t* line_data,
+										const word_t* column);
+
+/**
+ * Builds the mask of the lines used to update the totals from the columns:
+ * the uncovered lines if column is NULL, otherwise the uncovered lines that
+ * are covered by column.
+ * Stores the indexes of the non zero words of the mask in words and returns
+ * how many there are
+ */
+uint64_t get_column_mask(const cover_t* cover, const word_t* column,
+						 word_t* mask, uint64_t* words);
+
+/**
+ * Updates the totals of n_columns consecutive attributes, starting at
+ * first_attribute, from their columns:
+ * totals = popcount(column & mask), or
+ * totals -= popcount(column & mask) if subtract is true
+ * Only the n_mask_words words listed in words are checked
+ */
+oknok_t update_attribute_totals_columns(cover_t* cover, const word_t* columns,
+										const uint32_t first_attribute,
+										const uint32_t n_columns,
+										const word_t* mask,
+										const uint64_t* words,
+										const uint64_t n_mask_words,
+										const bool subtract);
+
+/**
+ * Calculates the attribute totals for the uncovered lines, using the
+ * column matrix stored in memory
+ */
+oknok_t update_attribute_totals_add_columns_mem(cover_t* cover,
+												const word_t* column_data);
+
+/**
+ * Removes the contribution of the lines that are about to be covered by
+ * column from the attribute totals, using the column matrix stored in memory
+ */
+oknok_t update_attribute_totals_sub_columns_mem(cover_t* cover,
+												const word_t* column_data,
+												const word_t* column);
 
 /**
  * Updates the list of covered lines, adding the lines covered by column
  */
-oknok_t update_covered_lines(cover_t* cover, word_t* column);
+oknok_t update_covered_lines(cover_t* cover, const word_t* column);
 
 /**
  * Prints the attributes that are part of the solution
@@ -7,156 +7,420 @@
  */
 
 #include "dataset_hdf5.h"
+#include "disjoint_matrix.h"
 #include "set_cover.h"
+#include "sparse_columns.h"
 #include "types/cover_t.h"
 #include "types/dataset_hdf5_t.h"
 #include "types/dm_t.h"
+#include "types/heap_t.h"
 #include "types/oknok_t.h"
+#include "types/sparse_column_t.h"
 #include "types/word_t.h"
 #include "utils/bit.h"
+#include "utils/bit_counters.h"
+#include "utils/heap.h"
 
 #include "hdf5.h"
 
 #include <assert.h>
+#include <omp.h>
 #include <set_cover_hdf5.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-oknok_t get_column(const hid_t dataset_id, const uint32_t attribute,
-				   const uint32_t n_words, word_t* column)
+const word_t* get_column(const dataset_hdf5_t* dataset,
+						 const uint32_t attribute, const uint64_t first_word,
+						 const uint64_t n_words, word_t* column)
 {
+	if (dataset->dm != NULL)
+	{
+		generate_dm_column(dataset->dm, attribute, first_word, n_words,
+						   column);
+		return column;
+	}
+
 	/**
 	 * Setup offset
 	 */
-	hsize_t offset[2] = { attribute, 0 };
+	hsize_t offset[2] = { attribute, first_word };
 
 	/**
 	 * Setup count
 	 */
 	hsize_t count[2] = { 1, n_words };
 
-	const hsize_t dimensions[2] = { 1, n_words };
+	// A column is always contiguous in a mapped dataset
+	const word_t* mapped = hdf5_get_mapped_words(dataset, offset, count);
+	if (mapped != NULL)
+	{
+		return mapped;
+	}
 
-	/**
-	 * Create a memory dataspace to indicate the size of our buffer/chunk
-	 */
-	hid_t memspace_id = H5Screate_simple(2, dimensions, NULL);
+	if (hdf5_read_words(dataset, offset, count, column) != OK)
+	{
+		return NULL;
+	}
+
+	return column;
+}
+
+int64_t get_best_attribute_index_lazy(cover_t* cover, heap_t* heap,
+									  const dataset_hdf5_t* column_dataset,
+									  const word_t* column_data,
+									  const sparse_columns_t* sparse_columns,
+									  sparse_column_t* sparse_column,
+									  word_t* column,
+									  const word_t** selected_column)
+{
+	while (heap->n_entries > 0)
+	{
+		heap_entry_t top = heap_top(heap);
+
+		// Refresh the total of the attribute on top
+		uint64_t total = 0;
+		if (column_data != NULL)
+		{
+			total = get_column_coverage(
+				cover, column_data + top.index * cover->n_words_in_a_column);
+		}
+		else if (sparse_columns != NULL)
+		{
+			// Only the lines of the column are read and checked
+			read_sparse_column(sparse_columns, top.index, sparse_column);
+
+			total = get_sparse_column_coverage(cover, sparse_column);
+		}
+		else
+		{
+			*selected_column = get_column(
+				column_dataset, top.index, cover->first_line / WORD_BITS,
+				cover->n_words_in_a_column, column);
+
+			total = get_column_coverage(cover, *selected_column);
+		}
+
+		cover->attribute_totals[top.index] = total;
+
+		heap_decrease_top(heap, total);
+
+		if (heap_top(heap).index == top.index)
+		{
+			/**
+			 * It's still on top, so no other attribute can beat it,
+			 * because their totals can only be lower than what's
+			 * in the heap
+			 */
+			heap_pop(heap);
+
+			if (total == 0)
+			{
+				return -1;
+			}
 
+			return top.index;
+		}
+	}
+
+	return -1;
+}
+
+uint64_t read_next_line_block(const cover_t* cover,
+							  const dataset_hdf5_t* line_dataset,
+							  const word_t* column, const uint64_t end_line,
+							  const uint32_t block_size,
+							  uint64_t* current_line, word_t* lines,
+							  const word_t** block)
+{
 	/**
-	 * Setup line dataspace
+	 * Number of lines read so far
 	 */
-	hid_t dataspace_id = H5Dget_space(dataset_id);
+	uint64_t n_lines = 0;
 
-	// Select hyperslab on file dataset
-	H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, NULL, count,
-						NULL);
+	*block = lines;
 
-	// Read line from dataset
-	H5Dread(dataset_id, H5T_NATIVE_UINT64, memspace_id, dataspace_id,
-			H5P_DEFAULT, column);
+	while (n_lines < block_size)
+	{
+		uint64_t start = 0;
+		uint64_t n_run_lines
+			= get_next_line_run(cover, column, *current_line, end_line, &start);
 
-	H5Sclose(dataspace_id);
-	H5Sclose(memspace_id);
+		if (n_run_lines == 0)
+		{
+			// No more lines to process
+			*current_line = end_line;
+			break;
+		}
 
-	return OK;
+		if (n_run_lines > block_size - n_lines)
+		{
+			// The rest of the run goes in the next block
+			n_run_lines = block_size - n_lines;
+		}
+
+		if (n_lines == 0 && n_run_lines == block_size)
+		{
+			// The block is a single run, use it where it is, if it's mapped
+			hsize_t offset[2] = { cover->first_line + start, 0 };
+			hsize_t count[2]  = { n_run_lines, cover->n_words_in_a_line };
+
+			const word_t* mapped
+				= hdf5_get_mapped_words(line_dataset, offset, count);
+			if (mapped != NULL)
+			{
+				*block		  = mapped;
+				*current_line = start + n_run_lines;
+				return n_run_lines;
+			}
+		}
+
+		// Read the whole run at once
+		hdf5_read_lines(line_dataset, cover->first_line + start,
+						cover->n_words_in_a_line, n_run_lines,
+						lines + n_lines * cover->n_words_in_a_line);
+
+		n_lines += n_run_lines;
+		*current_line = start + n_run_lines;
+	}
+
+	return n_lines;
 }
 
-oknok_t update_attribute_totals_add(cover_t* cover,
-									dataset_hdf5_t* line_dataset)
+/**
+ * Adds (or subtracts) the contribution of the lines to process to the
+ * attribute totals, reading block_size lines at a time.
+ * The blocks are double buffered: thread 0 reads the next block while the
+ * other threads split the current one between them, accumulating into
+ * private totals, which are then reduced into the attribute totals.
+ * Only thread 0 reads, so the hdf5 calls are never concurrent.
+ * If there's only one thread it reads and processes the blocks in turn
+ */
+static oknok_t update_attribute_totals_hdf5(cover_t* cover,
+											dataset_hdf5_t* line_dataset,
+											const word_t* column,
+											const uint32_t block_size,
+											const bool subtract)
 {
-	oknok_t ret = OK;
-
-	word_t* line = (word_t*) malloc(sizeof(word_t) * cover->n_words_in_a_line);
-	assert(line != NULL);
+	// The reader thread is one of them
+	uint32_t max_threads	= omp_get_max_threads();
+	uint64_t** partial_totals
+		= (uint64_t**) calloc(max_threads, sizeof(uint64_t*));
+	assert(partial_totals != NULL);
 
 	/**
-	 * Define the lines of the physical dataset to process
+	 * The buffers of the block being processed and of the one being read,
+	 * and where their lines are, in the buffers or in the dataset mapping
 	 */
-	uint32_t current_line = 0;
-	// uint32_t end_line	  = cover->n_matrix_lines;
+	word_t* blocks[2];
+	const word_t* block_lines[2] = { NULL, NULL };
+	uint64_t n_block_lines[2]	 = { 0, 0 };
 
-	// Reset totals
-	memset(cover->attribute_totals, 0, cover->n_attributes * sizeof(uint32_t));
+	for (uint8_t b = 0; b < 2; b++)
+	{
+		blocks[b] = (word_t*) malloc(sizeof(word_t) * block_size
+									 * cover->n_words_in_a_line);
+		assert(blocks[b] != NULL);
+	}
 
-	for (uint32_t w = 0; w < cover->n_words_in_a_column; w++)
+	/**
+	 * Next line to read
+	 */
+	uint64_t current_line = 0;
+
+#pragma omp parallel num_threads(max_threads)
 	{
-		word_t attribute_values = cover->covered_lines[w];
-		/*
-				uint8_t last_bit_to_process = 0;
-				if (end_line - current_line < WORD_BITS)
-				{
-					last_bit_to_process = WORD_BITS - (end_line - current_line);
-				}
-		*/
-		// Check the bits
-		for (int8_t bit = WORD_BITS - 1;
-			 bit >= 0 && current_line < cover->n_matrix_lines;
-			 bit--, current_line++)
+		uint32_t thread_id = omp_get_thread_num();
+		uint32_t n_threads = omp_get_num_threads();
+
+		// Thread 0 only reads, unless it's alone
+		bool is_reader		= thread_id == 0;
+		bool is_counter		= n_threads == 1 || thread_id > 0;
+		uint32_t n_counters = n_threads == 1 ? 1 : n_threads - 1;
+		uint32_t counter_id = n_threads == 1 ? 0 : thread_id - 1;
+
+		uint64_t* totals = NULL;
+		bit_counters_t counters;
+
+		if (is_counter)
 		{
-			if (!BIT_CHECK(attribute_values, bit))
+			totals = (uint64_t*) calloc(cover->n_words_in_a_line * WORD_BITS,
+										sizeof(uint64_t));
+			assert(totals != NULL);
+
+			init_bit_counters(&counters, cover->n_words_in_a_line, totals,
+							  false);
+		}
+
+#pragma omp single
+		n_block_lines[0] = read_next_line_block(
+			cover, line_dataset, column, cover->n_matrix_lines, block_size,
+			&current_line, blocks[0], &block_lines[0]);
+
+		for (uint32_t b = 0; n_block_lines[b % 2] > 0; b++)
+		{
+			uint8_t current = b % 2;
+			uint8_t next	= 1 - current;
+
+			if (is_reader)
 			{
-				// This line is not covered
+				// Prefetch the next block while the current one is processed
+				n_block_lines[next] = read_next_line_block(
+					cover, line_dataset, column, cover->n_matrix_lines,
+					block_size, &current_line, blocks[next],
+					&block_lines[next]);
+			}
 
-				// Read line from dataset
-				hdf5_read_line(line_dataset, current_line,
-							   cover->n_words_in_a_line, line);
+			if (is_counter)
+			{
+				// Our share of the current block
+				uint64_t n_lines = n_block_lines[current];
+				uint64_t from	 = n_lines * counter_id / n_counters;
+				uint64_t to		 = n_lines * (counter_id + 1) / n_counters;
 
-				// Increment totals
-				add_line_contribution(cover, line);
+				const word_t* line
+					= block_lines[current] + from * cover->n_words_in_a_line;
+
+				for (uint64_t l = from; l < to; l++)
+				{
+					bit_counters_add_line(&counters, line);
+					line += cover->n_words_in_a_line;
+				}
+
+				// The block buffer is about to be reused
+				bit_counters_sync(&counters);
 			}
+
+#pragma omp barrier
+		}
+
+		if (is_counter)
+		{
+			bit_counters_flush(&counters);
+			free_bit_counters(&counters);
+
+			partial_totals[counter_id] = totals;
 		}
+
+#pragma omp barrier
+
+		reduce_attribute_totals(cover, partial_totals, n_counters, subtract);
+
+		free(totals);
 	}
 
-	free(line);
+	free(blocks[0]);
+	free(blocks[1]);
+	free(partial_totals);
+
+	return OK;
+}
+
+oknok_t update_attribute_totals_add(cover_t* cover,
+									dataset_hdf5_t* line_dataset,
+									const uint32_t block_size)
+{
+	// Reset totals
+	memset(cover->attribute_totals, 0, cover->n_attributes * sizeof(uint64_t));
 
-	return ret;
+	return update_attribute_totals_hdf5(cover, line_dataset, NULL, block_size,
+										false);
 }
 
 oknok_t update_attribute_totals_sub(cover_t* cover,
 									dataset_hdf5_t* line_dataset,
-									word_t* column)
+									const word_t* column,
+									const uint32_t block_size)
 {
-	oknok_t ret = OK;
+	return update_attribute_totals_hdf5(cover, line_dataset, column,
+										block_size, true);
+}
 
-	word_t* line = (word_t*) malloc(sizeof(word_t) * cover->n_words_in_a_line);
-	assert(line != NULL);
+/**
+ * Updates the totals of all the attributes from the column dataset,
+ * reading blocks of consecutive columns
+ */
+static oknok_t update_attribute_totals_columns_hdf5(
+	cover_t* cover, dataset_hdf5_t* column_dataset, const word_t* column,
+	const uint32_t block_size, const bool subtract)
+{
+	word_t* mask
+		= (word_t*) malloc(cover->n_words_in_a_column * sizeof(word_t));
+	uint64_t* words
+		= (uint64_t*) malloc(cover->n_words_in_a_column * sizeof(uint64_t));
+	assert(mask != NULL && words != NULL);
+
+	uint64_t n_mask_words = get_column_mask(cover, column, mask, words);
 
 	/**
-	 * Define the lines of the physical dataset to process
+	 * Number of columns that fit in the memory of block_size lines
 	 */
-	uint32_t current_line = 0;
+	uint64_t n_columns_in_block = (uint64_t) block_size
+		* cover->n_words_in_a_line / cover->n_words_in_a_column;
+	if (n_columns_in_block == 0)
+	{
+		n_columns_in_block = 1;
+	}
+	if (n_columns_in_block > cover->n_attributes)
+	{
+		n_columns_in_block = cover->n_attributes;
+	}
+
+	word_t* columns = (word_t*) malloc(
+		n_columns_in_block * cover->n_words_in_a_column * sizeof(word_t));
+	assert(columns != NULL);
 
-	for (uint32_t w = 0; w < cover->n_words_in_a_column; w++)
+	// All the columns are read in order, unlike when picking them
+	hdf5_advise_dataset(column_dataset, true);
+
+	for (uint32_t a = 0; a < cover->n_attributes; a += n_columns_in_block)
 	{
-		// cov col
-		//   0   0   0
-		//   0   1   1
-		//   1   0   0
-		//   1   1   0
-
-		word_t attribute_values = ~cover->covered_lines[w] & column[w];
-
-		// Check the bits
-		for (int8_t bit = WORD_BITS - 1;
-			 bit >= 0 && current_line < cover->n_matrix_lines;
-			 bit--, current_line++)
+		uint32_t n_columns = n_columns_in_block;
+		if (a + n_columns > cover->n_attributes)
 		{
-			if (BIT_CHECK(attribute_values, bit))
-			{
-				// This line is covered
+			n_columns = cover->n_attributes - a;
+		}
 
-				// Read line from dataset
-				hdf5_read_line(line_dataset, current_line,
-							   cover->n_words_in_a_line, line);
+		// Only the words of the lines handled by this process
+		hsize_t offset[2] = { a, cover->first_line / WORD_BITS };
+		hsize_t count[2]  = { n_columns, cover->n_words_in_a_column };
 
-				// Increment totals
-				sub_line_contribution(cover, line);
-			}
+		// Whole columns are used where they are, if the dataset is mapped
+		const word_t* block
+			= hdf5_get_mapped_words(column_dataset, offset, count);
+		if (block == NULL)
+		{
+			hdf5_read_words(column_dataset, offset, count, columns);
+			block = columns;
 		}
+
+		update_attribute_totals_columns(cover, block, a, n_columns, mask,
+										words, n_mask_words, subtract);
 	}
 
-	free(line);
+	hdf5_advise_dataset(column_dataset, false);
+
+	free(columns);
+	free(words);
+	free(mask);
 
-	return ret;
+	return OK;
+}
+
+oknok_t update_attribute_totals_add_columns(cover_t* cover,
+											dataset_hdf5_t* column_dataset,
+											const uint32_t block_size)
+{
+	return update_attribute_totals_columns_hdf5(cover, column_dataset, NULL,
+												block_size, false);
+}
+
+oknok_t update_attribute_totals_sub_columns(cover_t* cover,
+											dataset_hdf5_t* column_dataset,
+											const word_t* column,
+											const uint32_t block_size)
+{
+	return update_attribute_totals_columns_hdf5(cover, column_dataset, column,
+												block_size, true);
 }
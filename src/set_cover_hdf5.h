@@ -12,27 +12,102 @@
 
 #include "types/cover_t.h"
 #include "types/dataset_hdf5_t.h"
+#include "types/heap_t.h"
 #include "types/oknok_t.h"
+#include "types/sparse_column_t.h"
 #include "types/word_t.h"
 
 #include "hdf5.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
- * Reads attribute data
+ * Returns the attribute data, n_words starting at first_word.
+ * If the dataset is mapped it's returned inside the mapping, otherwise
+ * it's read into column, or generated from the observations if the
+ * dataset has a disjoint matrix.
+ * Returns NULL if it couldn't be read
  */
-oknok_t get_column(const hid_t dataset, const uint32_t attribute,
-				   const uint32_t count, word_t* column);
+const word_t* get_column(const dataset_hdf5_t* dataset,
+						 const uint32_t attribute, const uint64_t first_word,
+						 const uint64_t n_words, word_t* column);
 
 /**
- *
+ * Lazy greedy selection of the best attribute.
+ * The heap holds upper bounds of the attribute totals: because the coverage
+ * of an attribute can only shrink, only the attribute on top needs to have
+ * its total refreshed, until the refreshed top stays on top.
+ * The columns are taken from column_data if it's not NULL, otherwise they're
+ * read from the sparse columns into sparse_column if sparse_columns isn't
+ * NULL, or from the column dataset into column.
+ * The selected attribute is removed from the heap, and its true total is
+ * stored in the attribute totals. If the columns are read, sparse_column
+ * holds the column of the selected attribute, or selected_column points
+ * to it, in column or in the mapping of the column dataset.
+ * Returns -1 if there are no more attributes available.
+ */
+int64_t get_best_attribute_index_lazy(cover_t* cover, heap_t* heap,
+									  const dataset_hdf5_t* column_dataset,
+									  const word_t* column_data,
+									  const sparse_columns_t* sparse_columns,
+									  sparse_column_t* sparse_column,
+									  word_t* column,
+									  const word_t** selected_column);
+
+/**
+ * Reads the next block of lines that need to be processed, starting the
+ * search at current_line and stopping before end_line. current_line is
+ * updated to where the next search resumes.
+ * Each run of consecutive lines is fetched with a single read.
+ * If column is NULL we read the uncovered lines, otherwise we read the
+ * uncovered lines that are covered by column.
+ * The block is read into lines, unless the dataset is mapped and its first
+ * run fills it: block then points to the run inside the mapping, otherwise
+ * to lines.
+ * Returns the number of lines read (up to block_size)
+ */
+uint64_t read_next_line_block(const cover_t* cover,
+							  const dataset_hdf5_t* line_dataset,
+							  const word_t* column, const uint64_t end_line,
+							  const uint32_t block_size,
+							  uint64_t* current_line, word_t* lines,
+							  const word_t** block);
+
+/**
+ * Calculates the attribute totals for the uncovered lines, reading
+ * block_size lines at a time.
+ * The lines are split between the available threads
  */
 oknok_t update_attribute_totals_add(cover_t* cover,
-									dataset_hdf5_t* line_dataset);
+									dataset_hdf5_t* line_dataset,
+									const uint32_t block_size);
 
+/**
+ * Removes the contribution of the lines that are about to be covered by
+ * column from the attribute totals, reading block_size lines at a time
+ */
 oknok_t update_attribute_totals_sub(cover_t* cover,
 									dataset_hdf5_t* line_dataset,
-									word_t* column);
+									const word_t* column,
+									const uint32_t block_size);
+
+/**
+ * Calculates the attribute totals for the uncovered lines from the column
+ * dataset, reading as many columns at a time as fit in the memory of
+ * block_size lines
+ */
+oknok_t update_attribute_totals_add_columns(cover_t* cover,
+											dataset_hdf5_t* column_dataset,
+											const uint32_t block_size);
+
+/**
+ * Removes the contribution of the lines that are about to be covered by
+ * column from the attribute totals, using the column dataset
+ */
+oknok_t update_attribute_totals_sub_columns(cover_t* cover,
+											dataset_hdf5_t* column_dataset,
+											const word_t* column,
+											const uint32_t block_size);
 
 #endif // SET_COVER_HDF5_H
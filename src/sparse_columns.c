@@ -0,0 +1,578 @@
+/*
+ ============================================================================
+ Name        : sparse_columns.c
+ Author      : Eduardo Ribeiro
+ Description : Structures and functions to store the disjoint matrix columns
+			   as the lines they cover and to apply the set cover with them.
+			   Each column is split in containers of SPARSE_CONTAINER_LINES
+			   lines, and only those with lines are stored: as the sorted
+			   offsets of their lines, or as a bitmap when they have many.
+			   So reading a column and updating the covered lines with it
+			   cost as much as the lines it covers
+ ============================================================================
+ */
+
+#include "sparse_columns.h"
+
+#include "dataset_hdf5.h"
+#include "types/cover_t.h"
+#include "types/oknok_t.h"
+#include "types/sparse_column_t.h"
+#include "types/word_t.h"
+#include "utils/bit.h"
+
+#include "hdf5.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Values of each container in the containers dataset
+ */
+#define SPARSE_CONTAINER_VALUES (sizeof(sparse_container_t) / sizeof(uint64_t))
+
+/**
+ * Lines of each chunk of the containers and line offsets datasets, small
+ * enough that reading a sparse column doesn't read much more than it has
+ */
+#define SPARSE_CONTAINERS_CHUNK	 256
+#define SPARSE_ARRAY_LINES_CHUNK 4096
+
+/**
+ * Makes room in the sparse column buffers for at least n_containers
+ * containers, n_array_lines line offsets and n_bitmaps bitmaps
+ */
+static void reserve_sparse_column(sparse_column_t* sparse_column,
+								  const uint64_t n_containers,
+								  const uint64_t n_array_lines,
+								  const uint64_t n_bitmaps)
+{
+	if (n_containers > sparse_column->max_containers)
+	{
+		sparse_column->max_containers
+			= n_containers > 2 * sparse_column->max_containers
+			? n_containers
+			: 2 * sparse_column->max_containers;
+
+		sparse_column->containers = (sparse_container_t*) realloc(
+			sparse_column->containers,
+			sparse_column->max_containers * sizeof(sparse_container_t));
+		assert(sparse_column->containers != NULL);
+	}
+
+	if (n_array_lines > sparse_column->max_array_lines)
+	{
+		sparse_column->max_array_lines
+			= n_array_lines > 2 * sparse_column->max_array_lines
+			? n_array_lines
+			: 2 * sparse_column->max_array_lines;
+
+		sparse_column->array_lines = (uint16_t*) realloc(
+			sparse_column->array_lines,
+			sparse_column->max_array_lines * sizeof(uint16_t));
+		assert(sparse_column->array_lines != NULL);
+	}
+
+	if (n_bitmaps > sparse_column->max_bitmaps)
+	{
+		sparse_column->max_bitmaps = n_bitmaps > 2 * sparse_column->max_bitmaps
+			? n_bitmaps
+			: 2 * sparse_column->max_bitmaps;
+
+		sparse_column->bitmaps = (word_t*) realloc(
+			sparse_column->bitmaps,
+			sparse_column->max_bitmaps * SPARSE_BITMAP_WORDS * sizeof(word_t));
+		assert(sparse_column->bitmaps != NULL);
+	}
+}
+
+/**
+ * Returns the words of the container that hold lines of the cover:
+ * from *first_word up to the returned one (exclusive), which are the words
+ * of the covered lines starting at *cover_word
+ */
+static inline uint64_t get_container_cover_words(
+	const cover_t* cover, const sparse_container_t* container,
+	uint64_t* first_word, uint64_t* cover_word)
+{
+	uint64_t cover_first = cover->first_line / WORD_BITS;
+	uint64_t cover_end	 = cover_first + cover->n_words_in_a_column;
+
+	uint64_t from = container->key * SPARSE_BITMAP_WORDS;
+	uint64_t to	  = from + SPARSE_BITMAP_WORDS;
+
+	if (to <= cover_first || from >= cover_end)
+	{
+		*first_word = 0;
+		*cover_word = 0;
+		return 0;
+	}
+
+	*first_word = from < cover_first ? cover_first - from : 0;
+	*cover_word = from + *first_word - cover_first;
+
+	return to > cover_end ? cover_end - from : SPARSE_BITMAP_WORDS;
+}
+
+void init_sparse_column(sparse_column_t* sparse_column)
+{
+	sparse_column->n_containers	   = 0;
+	sparse_column->containers	   = NULL;
+	sparse_column->n_array_lines   = 0;
+	sparse_column->array_lines	   = NULL;
+	sparse_column->n_bitmaps	   = 0;
+	sparse_column->bitmaps		   = NULL;
+	sparse_column->max_containers  = 0;
+	sparse_column->max_array_lines = 0;
+	sparse_column->max_bitmaps	   = 0;
+}
+
+oknok_t encode_sparse_column(const word_t* column, const uint64_t n_words,
+							 sparse_column_t* sparse_column)
+{
+	sparse_column->n_containers	 = 0;
+	sparse_column->n_array_lines = 0;
+	sparse_column->n_bitmaps	 = 0;
+
+	for (uint64_t first_word = 0; first_word < n_words;
+		 first_word += SPARSE_BITMAP_WORDS)
+	{
+		uint64_t end_word = first_word + SPARSE_BITMAP_WORDS;
+		if (end_word > n_words)
+		{
+			end_word = n_words;
+		}
+
+		uint64_t n_lines = 0;
+		for (uint64_t w = first_word; w < end_word; w++)
+		{
+			n_lines += __builtin_popcountl(column[w]);
+		}
+
+		// Empty containers aren't stored
+		if (n_lines == 0)
+		{
+			continue;
+		}
+
+		reserve_sparse_column(sparse_column, sparse_column->n_containers + 1,
+							  0, 0);
+
+		sparse_container_t* container
+			= sparse_column->containers + sparse_column->n_containers++;
+
+		container->key	   = first_word / SPARSE_BITMAP_WORDS;
+		container->n_lines = n_lines;
+
+		if (n_lines > SPARSE_ARRAY_MAX_LINES)
+		{
+			reserve_sparse_column(sparse_column, 0, 0,
+								  sparse_column->n_bitmaps + 1);
+
+			container->offset = sparse_column->n_bitmaps++;
+
+			word_t* bitmap = sparse_column->bitmaps
+				+ container->offset * SPARSE_BITMAP_WORDS;
+
+			memset(bitmap, 0, SPARSE_BITMAP_WORDS * sizeof(word_t));
+			memcpy(bitmap, column + first_word,
+				   (end_word - first_word) * sizeof(word_t));
+
+			continue;
+		}
+
+		reserve_sparse_column(sparse_column, 0,
+							  sparse_column->n_array_lines + n_lines, 0);
+
+		container->offset = sparse_column->n_array_lines;
+
+		for (uint64_t w = first_word; w < end_word; w++)
+		{
+			word_t bits = column[w];
+
+			// Lines are stored from the most significant bit
+			while (bits != 0)
+			{
+				uint8_t bit = __builtin_clzl(bits);
+
+				sparse_column->array_lines[sparse_column->n_array_lines++]
+					= (w - first_word) * WORD_BITS + bit;
+
+				BIT_CLEAR(bits, WORD_BITS - bit - 1);
+			}
+		}
+	}
+
+	return OK;
+}
+
+oknok_t create_sparse_columns(const hid_t file_id, const word_t* column_data,
+							  const uint32_t n_attributes,
+							  const uint64_t n_words)
+{
+	hid_t group_id = H5Gcreate(file_id, DM_SPARSE_COLUMNS, H5P_DEFAULT,
+							   H5P_DEFAULT, H5P_DEFAULT);
+	assert(group_id != NOK);
+
+	hid_t containers_id = hdf5_create_growing_dataset(
+		file_id, DM_SPARSE_CONTAINERS, SPARSE_CONTAINER_VALUES,
+		SPARSE_CONTAINERS_CHUNK, H5T_NATIVE_UINT64);
+
+	hid_t array_lines_id
+		= hdf5_create_growing_dataset(file_id, DM_SPARSE_ARRAY_LINES, 1,
+									  SPARSE_ARRAY_LINES_CHUNK,
+									  H5T_NATIVE_UINT16);
+
+	hid_t bitmaps_id = hdf5_create_growing_dataset(
+		file_id, DM_SPARSE_BITMAPS, SPARSE_BITMAP_WORDS, 1, H5T_NATIVE_UINT64);
+
+	uint64_t* index = (uint64_t*) calloc(
+		(uint64_t) (n_attributes + 1) * SPARSE_INDEX_WIDTH, sizeof(uint64_t));
+	assert(index != NULL);
+
+	/**
+	 * If the columns aren't in memory they're read from the column dataset,
+	 * as many at a time as each of its chunks has
+	 */
+	hid_t column_dset_id = NOK;
+	word_t* columns		 = NULL;
+	hsize_t n_columns	 = 1;
+
+	if (column_data == NULL)
+	{
+		column_dset_id = H5Dopen(file_id, DM_COLUMN_DATA, H5P_DEFAULT);
+		assert(column_dset_id != NOK);
+
+		hid_t dcpl_id = H5Dget_create_plist(column_dset_id);
+		assert(dcpl_id != NOK);
+
+		if (H5Pget_layout(dcpl_id) == H5D_CHUNKED)
+		{
+			hsize_t chunk_dimensions[2] = { 1, 0 };
+			H5Pget_chunk(dcpl_id, 2, chunk_dimensions);
+
+			n_columns = chunk_dimensions[0];
+		}
+
+		H5Pclose(dcpl_id);
+
+		columns = (word_t*) malloc(n_columns * n_words * sizeof(word_t));
+		assert(columns != NULL);
+	}
+
+	sparse_column_t sparse_column;
+	init_sparse_column(&sparse_column);
+
+	for (uint32_t a = 0; a < n_attributes; a++)
+	{
+		const word_t* column = NULL;
+
+		if (column_data != NULL)
+		{
+			column = column_data + (uint64_t) a * n_words;
+		}
+		else
+		{
+			uint32_t c = a % n_columns;
+
+			if (c == 0)
+			{
+				hsize_t offset[2] = { a, 0 };
+				hsize_t count[2]  = { n_columns, n_words };
+				if (a + n_columns > n_attributes)
+				{
+					count[0] = n_attributes - a;
+				}
+
+				hdf5_read_from_dataset(column_dset_id, offset, count,
+									   H5T_NATIVE_UINT64, columns);
+			}
+
+			column = columns + (uint64_t) c * n_words;
+		}
+
+		encode_sparse_column(column, n_words, &sparse_column);
+
+		// The offsets in the containers are relative to the column start
+		uint64_t* start = index + (uint64_t) a * SPARSE_INDEX_WIDTH;
+		uint64_t* end	= start + SPARSE_INDEX_WIDTH;
+
+		end[0] = start[0] + sparse_column.n_containers;
+		end[1] = start[1] + sparse_column.n_array_lines;
+		end[2] = start[2] + sparse_column.n_bitmaps;
+
+		hdf5_append_to_dataset(containers_id, sparse_column.n_containers,
+							   SPARSE_CONTAINER_VALUES, H5T_NATIVE_UINT64,
+							   sparse_column.containers);
+		hdf5_append_to_dataset(array_lines_id, sparse_column.n_array_lines, 1,
+							   H5T_NATIVE_UINT16, sparse_column.array_lines);
+		hdf5_append_to_dataset(bitmaps_id, sparse_column.n_bitmaps,
+							   SPARSE_BITMAP_WORDS, H5T_NATIVE_UINT64,
+							   sparse_column.bitmaps);
+	}
+
+	hid_t index_id
+		= hdf5_create_dataset(file_id, DM_SPARSE_INDEX, n_attributes + 1,
+							  SPARSE_INDEX_WIDTH, H5T_NATIVE_UINT64, NULL);
+
+	hsize_t offset[2] = { 0, 0 };
+	hsize_t count[2]  = { n_attributes + 1, SPARSE_INDEX_WIDTH };
+
+	hdf5_write_to_dataset(index_id, offset, count, H5T_NATIVE_UINT64, index);
+
+	free_sparse_column(&sparse_column);
+	free(index);
+	free(columns);
+
+	if (column_dset_id != NOK)
+	{
+		H5Dclose(column_dset_id);
+	}
+
+	H5Dclose(index_id);
+	H5Dclose(bitmaps_id);
+	H5Dclose(array_lines_id);
+	H5Dclose(containers_id);
+	H5Gclose(group_id);
+
+	return OK;
+}
+
+oknok_t open_sparse_columns(const hid_t file_id,
+							sparse_columns_t* sparse_columns)
+{
+	hid_t index_id = H5Dopen(file_id, DM_SPARSE_INDEX, H5P_DEFAULT);
+	assert(index_id != NOK);
+
+	hsize_t dimensions[2];
+	hdf5_get_dataset_dimensions(index_id, dimensions);
+
+	sparse_columns->n_attributes = dimensions[0] - 1;
+
+	sparse_columns->index
+		= (uint64_t*) malloc(dimensions[0] * dimensions[1] * sizeof(uint64_t));
+	assert(sparse_columns->index != NULL);
+
+	hsize_t offset[2] = { 0, 0 };
+	hdf5_read_from_dataset(index_id, offset, dimensions, H5T_NATIVE_UINT64,
+						   sparse_columns->index);
+
+	H5Dclose(index_id);
+
+	sparse_columns->containers_id
+		= H5Dopen(file_id, DM_SPARSE_CONTAINERS, H5P_DEFAULT);
+	assert(sparse_columns->containers_id != NOK);
+
+	sparse_columns->array_lines_id
+		= H5Dopen(file_id, DM_SPARSE_ARRAY_LINES, H5P_DEFAULT);
+	assert(sparse_columns->array_lines_id != NOK);
+
+	sparse_columns->bitmaps_id
+		= H5Dopen(file_id, DM_SPARSE_BITMAPS, H5P_DEFAULT);
+	assert(sparse_columns->bitmaps_id != NOK);
+
+	return OK;
+}
+
+oknok_t read_sparse_column(const sparse_columns_t* sparse_columns,
+						   const uint32_t attribute,
+						   sparse_column_t* sparse_column)
+{
+	const uint64_t* start
+		= sparse_columns->index + (uint64_t) attribute * SPARSE_INDEX_WIDTH;
+	const uint64_t* end = start + SPARSE_INDEX_WIDTH;
+
+	sparse_column->n_containers	 = end[0] - start[0];
+	sparse_column->n_array_lines = end[1] - start[1];
+	sparse_column->n_bitmaps	 = end[2] - start[2];
+
+	reserve_sparse_column(sparse_column, sparse_column->n_containers,
+						  sparse_column->n_array_lines,
+						  sparse_column->n_bitmaps);
+
+	hsize_t offset[2] = { start[0], 0 };
+	hsize_t count[2]  = { sparse_column->n_containers,
+						  SPARSE_CONTAINER_VALUES };
+
+	oknok_t ret = hdf5_read_from_dataset(sparse_columns->containers_id,
+										 offset, count, H5T_NATIVE_UINT64,
+										 sparse_column->containers);
+
+	offset[0] = start[1];
+	count[0]  = sparse_column->n_array_lines;
+	count[1]  = 1;
+
+	if (ret == OK)
+	{
+		ret = hdf5_read_from_dataset(sparse_columns->array_lines_id, offset,
+									 count, H5T_NATIVE_UINT16,
+									 sparse_column->array_lines);
+	}
+
+	offset[0] = start[2];
+	count[0]  = sparse_column->n_bitmaps;
+	count[1]  = SPARSE_BITMAP_WORDS;
+
+	if (ret == OK)
+	{
+		ret = hdf5_read_from_dataset(sparse_columns->bitmaps_id, offset, count,
+									 H5T_NATIVE_UINT64,
+									 sparse_column->bitmaps);
+	}
+
+	return ret;
+}
+
+uint64_t get_sparse_column_coverage(const cover_t* cover,
+									const sparse_column_t* sparse_column)
+{
+	uint64_t total = 0;
+
+	for (uint64_t c = 0; c < sparse_column->n_containers; c++)
+	{
+		const sparse_container_t* container = sparse_column->containers + c;
+
+		uint64_t from	  = 0;
+		uint64_t cover_w  = 0;
+		uint64_t end_word = get_container_cover_words(cover, container, &from,
+													  &cover_w);
+
+		const word_t* covered = cover->covered_lines + cover_w - from;
+
+		if (container->n_lines > SPARSE_ARRAY_MAX_LINES)
+		{
+			const word_t* bitmap = sparse_column->bitmaps
+				+ container->offset * SPARSE_BITMAP_WORDS;
+
+			for (uint64_t w = from; w < end_word; w++)
+			{
+				total += __builtin_popcountl(bitmap[w] & ~covered[w]);
+			}
+
+			continue;
+		}
+
+		const uint16_t* lines = sparse_column->array_lines + container->offset;
+
+		for (uint64_t l = 0; l < container->n_lines; l++)
+		{
+			uint64_t w = lines[l] / WORD_BITS;
+
+			if (w >= from && w < end_word)
+			{
+				total += !BIT_CHECK(covered[w],
+									WORD_BITS - (lines[l] % WORD_BITS) - 1);
+			}
+		}
+	}
+
+	return total;
+}
+
+oknok_t update_covered_lines_sparse(cover_t* cover,
+									const sparse_column_t* sparse_column)
+{
+	for (uint64_t c = 0; c < sparse_column->n_containers; c++)
+	{
+		const sparse_container_t* container = sparse_column->containers + c;
+
+		uint64_t from	  = 0;
+		uint64_t cover_w  = 0;
+		uint64_t end_word = get_container_cover_words(cover, container, &from,
+													  &cover_w);
+
+		word_t* covered = cover->covered_lines + cover_w - from;
+
+		if (container->n_lines > SPARSE_ARRAY_MAX_LINES)
+		{
+			const word_t* bitmap = sparse_column->bitmaps
+				+ container->offset * SPARSE_BITMAP_WORDS;
+
+			for (uint64_t w = from; w < end_word; w++)
+			{
+				BITMASK_SET(covered[w], bitmap[w]);
+			}
+
+			continue;
+		}
+
+		const uint16_t* lines = sparse_column->array_lines + container->offset;
+
+		for (uint64_t l = 0; l < container->n_lines; l++)
+		{
+			uint64_t w = lines[l] / WORD_BITS;
+
+			if (w >= from && w < end_word)
+			{
+				BIT_SET(covered[w], WORD_BITS - (lines[l] % WORD_BITS) - 1);
+			}
+		}
+	}
+
+	return OK;
+}
+
+oknok_t sparse_column_to_dense(const cover_t* cover,
+							   const sparse_column_t* sparse_column,
+							   word_t* column)
+{
+	memset(column, 0, cover->n_words_in_a_column * sizeof(word_t));
+
+	for (uint64_t c = 0; c < sparse_column->n_containers; c++)
+	{
+		const sparse_container_t* container = sparse_column->containers + c;
+
+		uint64_t from	  = 0;
+		uint64_t cover_w  = 0;
+		uint64_t end_word = get_container_cover_words(cover, container, &from,
+													  &cover_w);
+
+		if (container->n_lines > SPARSE_ARRAY_MAX_LINES)
+		{
+			const word_t* bitmap = sparse_column->bitmaps
+				+ container->offset * SPARSE_BITMAP_WORDS;
+
+			memcpy(column + cover_w, bitmap + from,
+				   (end_word - from) * sizeof(word_t));
+
+			continue;
+		}
+
+		const uint16_t* lines = sparse_column->array_lines + container->offset;
+
+		for (uint64_t l = 0; l < container->n_lines; l++)
+		{
+			uint64_t w = lines[l] / WORD_BITS;
+
+			if (w >= from && w < end_word)
+			{
+				BIT_SET(column[cover_w + w - from],
+						WORD_BITS - (lines[l] % WORD_BITS) - 1);
+			}
+		}
+	}
+
+	return OK;
+}
+
+void free_sparse_column(sparse_column_t* sparse_column)
+{
+	free(sparse_column->containers);
+	free(sparse_column->array_lines);
+	free(sparse_column->bitmaps);
+
+	init_sparse_column(sparse_column);
+}
+
+void close_sparse_columns(sparse_columns_t* sparse_columns)
+{
+	free(sparse_columns->index);
+	sparse_columns->index = NULL;
+
+	H5Dclose(sparse_columns->containers_id);
+	H5Dclose(sparse_columns->array_lines_id);
+	H5Dclose(sparse_columns->bitmaps_id);
+}
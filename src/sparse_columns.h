@@ -0,0 +1,84 @@
+/*
+ ============================================================================
+ Name        : sparse_columns.h
+ Author      : Eduardo Ribeiro
+ Description : Structures and functions to store the disjoint matrix columns
+			   as the lines they cover and to apply the set cover with them
+ ============================================================================
+ */
+
+#ifndef SPARSE_COLUMNS_H
+#define SPARSE_COLUMNS_H
+
+#include "types/cover_t.h"
+#include "types/oknok_t.h"
+#include "types/sparse_column_t.h"
+#include "types/word_t.h"
+
+#include "hdf5.h"
+
+#include <stdint.h>
+
+/**
+ * Initializes an empty sparse column
+ */
+void init_sparse_column(sparse_column_t* sparse_column);
+
+/**
+ * Stores the lines of a column of n_words words in the sparse column
+ */
+oknok_t encode_sparse_column(const word_t* column, const uint64_t n_words,
+							 sparse_column_t* sparse_column);
+
+/**
+ * Creates the sparse columns group from the disjoint matrix columns.
+ * They're taken from column_data if it's not NULL, otherwise they're read
+ * from the column dataset, a chunk of columns at a time
+ */
+oknok_t create_sparse_columns(const hid_t file_id, const word_t* column_data,
+							  const uint32_t n_attributes,
+							  const uint64_t n_words);
+
+/**
+ * Opens the sparse columns group and reads its index
+ */
+oknok_t open_sparse_columns(const hid_t file_id,
+							sparse_columns_t* sparse_columns);
+
+/**
+ * Reads the sparse column of the attribute
+ */
+oknok_t read_sparse_column(const sparse_columns_t* sparse_columns,
+						   const uint32_t attribute,
+						   sparse_column_t* sparse_column);
+
+/**
+ * Returns the number of uncovered lines covered by the sparse column
+ */
+uint64_t get_sparse_column_coverage(const cover_t* cover,
+									const sparse_column_t* sparse_column);
+
+/**
+ * Marks the lines of the sparse column as covered
+ */
+oknok_t update_covered_lines_sparse(cover_t* cover,
+									const sparse_column_t* sparse_column);
+
+/**
+ * Writes the sparse column as the dense column of the lines of the cover
+ */
+oknok_t sparse_column_to_dense(const cover_t* cover,
+							   const sparse_column_t* sparse_column,
+							   word_t* column);
+
+/**
+ * Frees the sparse column buffers
+ */
+void free_sparse_column(sparse_column_t* sparse_column);
+
+/**
+ * Closes the sparse columns datasets and frees the index
+ */
+void close_sparse_columns(sparse_columns_t* sparse_columns);
+
+#endif
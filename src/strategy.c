@@ -0,0 +1,195 @@
+/*
+ ============================================================================
+ Name        : strategy.c
+ Author      : Eduardo Ribeiro
+ Description : Selection of the strategy used to update the attribute totals.
+			   The cost of each strategy is estimated from the amount of
+			   data it has to process and the throughput measured on the
+			   previous iterations
+ ============================================================================
+ */
+
+#include "strategy.h"
+
+#include "types/cover_t.h"
+#include "types/strategy_t.h"
+#include "types/working_set_t.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static const char* STRATEGY_NAMES[N_STRATEGIES]
+	= { "lines/add",   "lines/sub",		  "columns/add",
+		"columns/sub", "working set/add", "working set/sub" };
+
+void init_strategy_selector(strategy_selector_t* selector,
+							const bool use_cost_model,
+							const bool column_totals,
+							const bool line_data_in_memory,
+							const bool column_data_in_memory,
+							const bool generated_matrix)
+{
+	selector->use_cost_model = use_cost_model;
+	selector->column_totals	 = column_totals;
+	selector->has_columns	 = !generated_matrix;
+
+	double lines_seconds = line_data_in_memory || generated_matrix
+		? STRATEGY_MEM_SECONDS_PER_WORD
+		: STRATEGY_LINES_SECONDS_PER_WORD;
+
+	double columns_seconds = column_data_in_memory
+		? STRATEGY_MEM_SECONDS_PER_WORD
+		: STRATEGY_COLUMNS_SECONDS_PER_WORD;
+
+	// The working set is always in memory
+	double* seconds_per_word = selector->seconds_per_word;
+
+	seconds_per_word[STRATEGY_LINES_ADD]	   = lines_seconds;
+	seconds_per_word[STRATEGY_LINES_SUB]	   = lines_seconds;
+	seconds_per_word[STRATEGY_COLUMNS_ADD]	   = columns_seconds;
+	seconds_per_word[STRATEGY_COLUMNS_SUB]	   = columns_seconds;
+	seconds_per_word[STRATEGY_WORKING_SET_ADD] = STRATEGY_MEM_SECONDS_PER_WORD;
+	seconds_per_word[STRATEGY_WORKING_SET_SUB] = STRATEGY_MEM_SECONDS_PER_WORD;
+
+	for (uint8_t s = 0; s < N_STRATEGIES; s++)
+	{
+		selector->n_samples[s] = 0;
+		selector->n_words[s]   = 0;
+		selector->cost[s]	   = -1;
+	}
+}
+
+/**
+ * The strategy the command line options ask for.
+ * The working set is used as soon as it exists.
+ * If the best attribute covers more lines than the ones that remain
+ * uncovered we recalculate the totals, otherwise we remove the
+ * contribution of the newly covered lines
+ */
+static strategy_t get_fixed_strategy(const strategy_selector_t* selector,
+									 const cover_t* cover,
+									 const working_set_t* ws,
+									 const uint64_t best_total)
+{
+	bool add = best_total > cover->n_uncovered_lines;
+
+	if (ws->lines != NULL)
+	{
+		return add ? STRATEGY_WORKING_SET_ADD : STRATEGY_WORKING_SET_SUB;
+	}
+
+	if (selector->column_totals && selector->has_columns)
+	{
+		return add ? STRATEGY_COLUMNS_ADD : STRATEGY_COLUMNS_SUB;
+	}
+
+	return add ? STRATEGY_LINES_ADD : STRATEGY_LINES_SUB;
+}
+
+strategy_t select_strategy(strategy_selector_t* selector,
+						   const cover_t* cover, const working_set_t* ws,
+						   const uint64_t best_total)
+{
+	/**
+	 * Words each strategy has to go through
+	 */
+	uint64_t line_words	  = cover->n_words_in_a_line;
+	uint64_t column_words = (uint64_t) cover->n_attributes
+		* cover->n_words_in_a_column;
+
+	selector->n_words[STRATEGY_LINES_ADD]
+		= cover->n_uncovered_lines * line_words;
+	selector->n_words[STRATEGY_LINES_SUB]		= best_total * line_words;
+	selector->n_words[STRATEGY_COLUMNS_ADD]		= column_words;
+	selector->n_words[STRATEGY_COLUMNS_SUB]		= column_words;
+	selector->n_words[STRATEGY_WORKING_SET_ADD] = ws->n_lines * line_words;
+	selector->n_words[STRATEGY_WORKING_SET_SUB] = ws->n_lines * line_words;
+
+	strategy_t best = get_fixed_strategy(selector, cover, ws, best_total);
+
+	for (uint8_t s = 0; s < N_STRATEGIES; s++)
+	{
+		selector->cost[s]
+			= selector->n_words[s] * selector->seconds_per_word[s];
+	}
+
+	if (ws->lines == NULL)
+	{
+		selector->cost[STRATEGY_WORKING_SET_ADD] = -1;
+		selector->cost[STRATEGY_WORKING_SET_SUB] = -1;
+	}
+
+	if (!selector->has_columns)
+	{
+		selector->cost[STRATEGY_COLUMNS_ADD] = -1;
+		selector->cost[STRATEGY_COLUMNS_SUB] = -1;
+	}
+
+	if (!selector->use_cost_model)
+	{
+		return best;
+	}
+
+	// Start from the fixed strategy, so it wins the ties
+	for (uint8_t s = 0; s < N_STRATEGIES; s++)
+	{
+		if (selector->cost[s] >= 0 && selector->cost[s] < selector->cost[best])
+		{
+			best = (strategy_t) s;
+		}
+	}
+
+	return best;
+}
+
+void record_strategy_time(strategy_selector_t* selector,
+						  const strategy_t strategy, const double seconds)
+{
+	if (selector->n_words[strategy] == 0)
+	{
+		return;
+	}
+
+	double seconds_per_word = seconds / selector->n_words[strategy];
+
+	// The first measure replaces the default value, then we average
+	if (selector->n_samples[strategy] == 0)
+	{
+		selector->seconds_per_word[strategy] = seconds_per_word;
+	}
+	else
+	{
+		selector->seconds_per_word[strategy]
+			= (selector->seconds_per_word[strategy] + seconds_per_word) / 2;
+	}
+
+	selector->n_samples[strategy]++;
+}
+
+void print_strategy(FILE* stream, const strategy_selector_t* selector,
+					const strategy_t strategy)
+{
+	fprintf(stream, "  Strategy: %s, estimated %0.6fs (",
+			get_strategy_name(strategy), selector->cost[strategy]);
+
+	bool first = true;
+	for (uint8_t s = 0; s < N_STRATEGIES; s++)
+	{
+		if (s == strategy || selector->cost[s] < 0)
+		{
+			continue;
+		}
+
+		fprintf(stream, "%s%s %0.6fs", first ? "" : ", ",
+				get_strategy_name((strategy_t) s), selector->cost[s]);
+		first = false;
+	}
+
+	fprintf(stream, ")\n");
+}
+
+const char* get_strategy_name(const strategy_t strategy)
+{
+	return STRATEGY_NAMES[strategy];
+}
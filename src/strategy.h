@@ -0,0 +1,78 @@
+/*
+ ============================================================================
+ Name        : strategy.h
+ Author      : Eduardo Ribeiro
+ Description : Selection of the strategy used to update the attribute totals.
+			   The cost of each strategy is estimated from the amount of
+			   data it has to process and the throughput measured on the
+			   previous iterations
+ ============================================================================
+ */
+
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include "types/cover_t.h"
+#include "types/strategy_t.h"
+#include "types/working_set_t.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Default time to process one word kept in memory
+ */
+#define STRATEGY_MEM_SECONDS_PER_WORD 0.5e-9
+
+/**
+ * Default time to process one word read from the line dataset
+ */
+#define STRATEGY_LINES_SECONDS_PER_WORD 4e-9
+
+/**
+ * Default time to process one word read from the column dataset
+ */
+#define STRATEGY_COLUMNS_SECONDS_PER_WORD 2e-9
+
+/**
+ * Initializes the selector.
+ * The default throughput depends on where the line and column matrices are.
+ * A generated matrix has its lines built in memory, and no column matrix to
+ * go through
+ */
+void init_strategy_selector(strategy_selector_t* selector,
+							const bool use_cost_model,
+							const bool column_totals,
+							const bool line_data_in_memory,
+							const bool column_data_in_memory,
+							const bool generated_matrix);
+
+/**
+ * Chooses the strategy to update the attribute totals, after selecting an
+ * attribute that covers best_total of the uncovered lines.
+ * ws is used only if it's not empty
+ */
+strategy_t select_strategy(strategy_selector_t* selector,
+						   const cover_t* cover, const working_set_t* ws,
+						   const uint64_t best_total);
+
+/**
+ * Updates the throughput of strategy with the time it took on this
+ * iteration
+ */
+void record_strategy_time(strategy_selector_t* selector,
+						  const strategy_t strategy, const double seconds);
+
+/**
+ * Prints the chosen strategy and its estimated cost
+ */
+void print_strategy(FILE* stream, const strategy_selector_t* selector,
+					const strategy_t strategy);
+
+/**
+ * Returns the name of the strategy
+ */
+const char* get_strategy_name(const strategy_t strategy);
+
+#endif // STRATEGY_H
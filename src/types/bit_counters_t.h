@@ -0,0 +1,84 @@
+/*
+ ============================================================================
+ Name        : types/bit_counters_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing a set of bit-sliced vertical counters
+ ============================================================================
+ */
+
+#ifndef TYPES_BIT_COUNTERS_T_H
+#define TYPES_BIT_COUNTERS_T_H
+
+#include "types/word_t.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Number of lines added together by the carry-save adders
+ */
+#define BIT_COUNTERS_GROUP 8
+
+/**
+ * Number of bit planes used to count the groups.
+ * The counters are flushed every 2^BIT_COUNTERS_PLANES - 1 groups
+ */
+#define BIT_COUNTERS_PLANES 8
+
+typedef struct bit_counters_t
+{
+	/**
+	 * Number of words in a line
+	 */
+	uint32_t n_words;
+
+	/**
+	 * Number of groups counted since the last flush
+	 */
+	uint32_t n_groups;
+
+	/**
+	 * Lines waiting to complete a group
+	 */
+	const word_t* pending[BIT_COUNTERS_GROUP];
+
+	/**
+	 * Number of lines waiting to complete a group
+	 */
+	uint8_t n_pending;
+
+	/**
+	 * Carry-save accumulators, with weights 1, 2 and 4
+	 */
+	word_t* ones;
+	word_t* twos;
+	word_t* fours;
+
+	/**
+	 * Bit planes counting the groups (weight 8)
+	 * BIT_COUNTERS_PLANES blocks of n_words
+	 */
+	word_t* planes;
+
+	/**
+	 * Carries from the adders to the bit planes
+	 */
+	word_t* carry;
+
+	/**
+	 * A line of zeros, used to complete partial groups
+	 */
+	word_t* zeros;
+
+	/**
+	 * Totals updated on flush, one per bit of a line
+	 */
+	uint64_t* totals;
+
+	/**
+	 * Subtract the counts from the totals instead of adding them
+	 */
+	bool subtract;
+} bit_counters_t;
+
+#endif // TYPES_BIT_COUNTERS_T_H
@@ -22,8 +22,15 @@ typedef struct cover_t
 
 	/**
 	 * Total number of lines of the disjoint matrix
+	 * When the lines are split between processes, it's the number of lines
+	 * handled by this process
 	 */
-	uint32_t n_matrix_lines;
+	uint64_t n_matrix_lines;
+
+	/**
+	 * Index of the first matrix line handled by this process
+	 */
+	uint64_t first_line;
 
 	/**
 	 * Number of words needed to store a line
@@ -33,7 +40,7 @@ typedef struct cover_t
 	/**
 	 * Number of words needed to store a column
 	 */
-	uint32_t n_words_in_a_column;
+	uint64_t n_words_in_a_column;
 
 	/**
 	 * Bit array of covered lines
@@ -43,7 +50,7 @@ typedef struct cover_t
 	/**
 	 * Number of lines that are not covered yet
 	 */
-	uint32_t n_uncovered_lines;
+	uint64_t n_uncovered_lines;
 
 	/**
 	 * Bit array of selected attributes
@@ -53,7 +60,7 @@ typedef struct cover_t
 	/**
 	 * Array with the current totals for all attributes
 	 */
-	uint32_t* attribute_totals;
+	uint64_t* attribute_totals;
 } cover_t;
 
 #endif // TYPES_COVER_T_H
@@ -9,6 +9,10 @@
 #ifndef HDF5_DATASET_T_H
 #define HDF5_DATASET_T_H
 
+#include "types/dataset_map_t.h"
+#include "types/dm_t.h"
+#include "types/line_tiles_t.h"
+
 #include "hdf5.h"
 
 typedef struct dataset_hdf5_t
@@ -28,6 +32,24 @@ typedef struct dataset_hdf5_t
 	 */
 	hsize_t dimensions[2];
 
+	/**
+	 * If not NULL, this is the column dataset of a disjoint matrix stored
+	 * once, and its lines are read from its tiles
+	 */
+	line_tiles_t* tiles;
+
+	/**
+	 * If not NULL, the disjoint matrix isn't stored, its lines and columns
+	 * are generated from the observations of dm
+	 */
+	const dm_t* dm;
+
+	/**
+	 * If not NULL, the dataset is contiguous and mapped into memory, and
+	 * it's read from the mapping instead of with H5Dread
+	 */
+	dataset_map_t* map;
+
 } dataset_hdf5_t;
 
 #endif // HDF5_DATASET_T_H
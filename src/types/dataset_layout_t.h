@@ -0,0 +1,35 @@
+/*
+ ============================================================================
+ Name        : dataset_layout_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing the storage layout of a hdf5 dataset
+ ============================================================================
+ */
+
+#ifndef DATASET_LAYOUT_T_H
+#define DATASET_LAYOUT_T_H
+
+#include "hdf5.h"
+
+#include <stdint.h>
+
+typedef struct dataset_layout_t
+{
+	/**
+	 * Lines and words of each chunk. 0 lines means a contiguous dataset
+	 */
+	hsize_t chunk_dimensions[2];
+
+	/**
+	 * Deflate level of the chunks, which are shuffled first.
+	 * 0 means they aren't compressed
+	 */
+	uint32_t deflate_level;
+
+	/**
+	 * Size (in bytes) of the chunk cache. 0 means room for two chunks
+	 */
+	uint64_t chunk_cache_size;
+} dataset_layout_t;
+
+#endif // DATASET_LAYOUT_T_H
@@ -0,0 +1,32 @@
+/*
+ ============================================================================
+ Name        : dataset_map_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing a contiguous hdf5 dataset mapped into
+			   memory
+ ============================================================================
+ */
+
+#ifndef DATASET_MAP_T_H
+#define DATASET_MAP_T_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct dataset_map_t
+{
+	/**
+	 * Address and length of the mapping, which starts at the page holding
+	 * the first byte of the dataset
+	 */
+	void* address;
+	size_t length;
+
+	/**
+	 * The dataset data inside the mapping. It may not be aligned to a word,
+	 * so it's only copied from
+	 */
+	const uint8_t* data;
+} dataset_map_t;
+
+#endif // DATASET_MAP_T_H
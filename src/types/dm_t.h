@@ -10,7 +10,7 @@
 #ifndef DM_T_H
 #define DM_T_H
 
-#include "steps_t.h"
+#include "types/word_t.h"
 
 #include <stdint.h>
 
@@ -19,12 +19,33 @@ typedef struct dm_t
 	/**
 	 * The number of lines of the full matrix
 	 */
-	uint32_t n_matrix_lines;
+	uint64_t n_matrix_lines;
 
 	/**
-	 * Steps to generate the partial disjoint matrix
+	 * The class buckets, used to generate the steps on demand
 	 */
-	steps_t* steps;
+	uint32_t n_classes;
+
+	/**
+	 * Stride between the classes in observations_per_class
+	 */
+	uint32_t n_observations;
+
+	/**
+	 * Number of observations of each class
+	 */
+	const uint32_t* n_observations_per_class;
+
+	/**
+	 * Observations of each class
+	 */
+	word_t* const* observations_per_class;
+
+	/**
+	 * Observations of each class in the tiles of the blocked line order.
+	 * 0 means the lines follow the order of the observations
+	 */
+	uint32_t tile_size;
 } dm_t;
 
 #endif // DM_T_H
@@ -0,0 +1,40 @@
+/*
+ ============================================================================
+ Name        : types/heap_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing a max-heap of indexed values
+ ============================================================================
+ */
+
+#ifndef TYPES_HEAP_T_H
+#define TYPES_HEAP_T_H
+
+#include <stdint.h>
+
+typedef struct heap_entry_t
+{
+	/**
+	 * Index of the item
+	 */
+	uint32_t index;
+
+	/**
+	 * Value of the item
+	 */
+	uint64_t value;
+} heap_entry_t;
+
+typedef struct heap_t
+{
+	/**
+	 * Number of entries in the heap
+	 */
+	uint32_t n_entries;
+
+	/**
+	 * The entries, in heap order
+	 */
+	heap_entry_t* entries;
+} heap_t;
+
+#endif // TYPES_HEAP_T_H
@@ -0,0 +1,30 @@
+/*
+ ============================================================================
+ Name        : io_stats_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing the data read from and written to the
+			   hdf5 datasets
+ ============================================================================
+ */
+
+#ifndef IO_STATS_T_H
+#define IO_STATS_T_H
+
+#include <stdint.h>
+
+typedef struct io_stats_t
+{
+	/**
+	 * Bytes read and the time (in seconds) spent reading them
+	 */
+	uint64_t bytes_read;
+	double read_time;
+
+	/**
+	 * Bytes written and the time (in seconds) spent writing them
+	 */
+	uint64_t bytes_written;
+	double write_time;
+} io_stats_t;
+
+#endif // IO_STATS_T_H
@@ -0,0 +1,46 @@
+/*
+ ============================================================================
+ Name        : line_tiles_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing the lines of the disjoint matrix last
+			   read from the tiles of its column dataset
+ ============================================================================
+ */
+
+#ifndef LINE_TILES_T_H
+#define LINE_TILES_T_H
+
+#include "types/word_t.h"
+
+#include <stdint.h>
+
+typedef struct line_tiles_t
+{
+	/**
+	 * Words of each column read at a time
+	 */
+	uint64_t n_column_words;
+
+	/**
+	 * Words of each line
+	 */
+	uint32_t n_words;
+
+	/**
+	 * First line read and the number of lines read
+	 */
+	uint64_t first_line;
+	uint64_t n_lines;
+
+	/**
+	 * The columns read, n_column_words for each attribute
+	 */
+	word_t* columns;
+
+	/**
+	 * The lines transposed from the columns, n_words each
+	 */
+	word_t* lines;
+} line_tiles_t;
+
+#endif // LINE_TILES_T_H
@@ -0,0 +1,60 @@
+/*
+ ============================================================================
+ Name        : types/partition_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing the partition of the observations by
+			   their values on the selected attributes
+ ============================================================================
+ */
+
+#ifndef TYPES_PARTITION_T_H
+#define TYPES_PARTITION_T_H
+
+#include "types/word_t.h"
+
+#include <stdint.h>
+
+typedef struct partition_t
+{
+	/**
+	 * Number of words of each observation
+	 */
+	uint32_t n_words;
+
+	/**
+	 * Number of observations still in the partition.
+	 * Only blocks with observations from more than one class are kept,
+	 * the others don't have uncovered lines
+	 */
+	uint32_t n_observations;
+
+	/**
+	 * The observations, grouped by block and by class inside each block
+	 */
+	word_t** observations;
+
+	/**
+	 * The class of each observation
+	 */
+	uint32_t* classes;
+
+	/**
+	 * Number of blocks
+	 */
+	uint32_t n_blocks;
+
+	/**
+	 * Index of the first observation of each block, plus the end of the
+	 * last block
+	 */
+	uint32_t* block_starts;
+
+	/**
+	 * Buffers to refine the partition into
+	 */
+	word_t** next_observations;
+	uint32_t* next_classes;
+	uint32_t* next_block_starts;
+} partition_t;
+
+#endif // TYPES_PARTITION_T_H
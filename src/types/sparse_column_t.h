@@ -0,0 +1,111 @@
+/*
+ ============================================================================
+ Name        : sparse_column_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatypes representing a column of the disjoint matrix
+			   stored as the lines it covers, in containers of
+			   SPARSE_CONTAINER_LINES lines, and the hdf5 group that stores
+			   all the columns this way
+ ============================================================================
+ */
+
+#ifndef SPARSE_COLUMN_T_H
+#define SPARSE_COLUMN_T_H
+
+#include "types/word_t.h"
+
+#include "hdf5.h"
+
+#include <stdint.h>
+
+/**
+ * Lines of each container, its lines are stored as 16 bit offsets
+ */
+#define SPARSE_CONTAINER_LINES 65536
+
+/**
+ * Words of the bitmap of a container
+ */
+#define SPARSE_BITMAP_WORDS (SPARSE_CONTAINER_LINES / WORD_BITS)
+
+/**
+ * Containers with more lines than this are stored as bitmaps,
+ * which then take less space than the offsets
+ */
+#define SPARSE_ARRAY_MAX_LINES 4096
+
+/**
+ * Values of each column in the index: where its containers, line offsets
+ * and bitmaps start
+ */
+#define SPARSE_INDEX_WIDTH 3
+
+typedef struct sparse_container_t
+{
+	/**
+	 * The container number, its first line is key * SPARSE_CONTAINER_LINES
+	 */
+	uint64_t key;
+
+	/**
+	 * Number of lines of the column in the container
+	 */
+	uint64_t n_lines;
+
+	/**
+	 * Index of its first line offset, or of its bitmap if it has more than
+	 * SPARSE_ARRAY_MAX_LINES lines
+	 */
+	uint64_t offset;
+} sparse_container_t;
+
+typedef struct sparse_column_t
+{
+	/**
+	 * The containers with lines, sorted by key
+	 */
+	uint64_t n_containers;
+	sparse_container_t* containers;
+
+	/**
+	 * Line offsets of the array containers, sorted
+	 */
+	uint64_t n_array_lines;
+	uint16_t* array_lines;
+
+	/**
+	 * Bitmaps of the bitmap containers, SPARSE_BITMAP_WORDS each
+	 */
+	uint64_t n_bitmaps;
+	word_t* bitmaps;
+
+	/**
+	 * Allocated sizes of the buffers above
+	 */
+	uint64_t max_containers;
+	uint64_t max_array_lines;
+	uint64_t max_bitmaps;
+} sparse_column_t;
+
+typedef struct sparse_columns_t
+{
+	/**
+	 * Number of columns
+	 */
+	uint32_t n_attributes;
+
+	/**
+	 * SPARSE_INDEX_WIDTH values for each column, plus the totals at the
+	 * end
+	 */
+	uint64_t* index;
+
+	/**
+	 * The datasets of the containers, line offsets and bitmaps
+	 */
+	hid_t containers_id;
+	hid_t array_lines_id;
+	hid_t bitmaps_id;
+} sparse_columns_t;
+
+#endif // SPARSE_COLUMN_T_H
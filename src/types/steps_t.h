@@ -1,8 +1,11 @@
 /*
- * steps_t.h
- *
- *  Created on: 03/08/2023
- *      Author: edu
+ ============================================================================
+ Name        : types/steps_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing a step of the disjoint matrix: the pair
+			   of observations, from different classes, that generate one
+			   matrix line
+ ============================================================================
  */
 
 #ifndef SRC_TYPES_STEPS_T_H_
@@ -10,8 +13,38 @@
 
 #include "types/word_t.h"
 
+#include <stdint.h>
+
 typedef struct steps_t
 {
+	/**
+	 * Class and index (in the class) of the first observation
+	 */
+	uint32_t class_a;
+	uint32_t index_a;
+
+	/**
+	 * Class and index (in the class) of the second observation
+	 */
+	uint32_t class_b;
+	uint32_t index_b;
+
+	/**
+	 * End of the observations of class b paired with the first observation
+	 * before moving on
+	 */
+	uint32_t end_b;
+
+	/**
+	 * First observations of class a and class b in the current tile, in
+	 * the blocked line order
+	 */
+	uint32_t tile_a;
+	uint32_t tile_b;
+
+	/**
+	 * The observations. NULL after the last step
+	 */
 	word_t* lineA;
 	word_t* lineB;
 } steps_t;
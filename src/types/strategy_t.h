@@ -0,0 +1,94 @@
+/*
+ ============================================================================
+ Name        : types/strategy_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatypes to choose how the attribute totals are updated
+ ============================================================================
+ */
+
+#ifndef TYPES_STRATEGY_T_H
+#define TYPES_STRATEGY_T_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The ways we have to update the attribute totals after each selection
+ */
+typedef enum strategy_t
+{
+	/**
+	 * Recalculate the totals from the uncovered lines
+	 */
+	STRATEGY_LINES_ADD = 0,
+
+	/**
+	 * Subtract the contribution of the lines covered by the best attribute
+	 */
+	STRATEGY_LINES_SUB,
+
+	/**
+	 * Recalculate the totals from the columns
+	 */
+	STRATEGY_COLUMNS_ADD,
+
+	/**
+	 * Subtract the lines covered by the best attribute, from the columns
+	 */
+	STRATEGY_COLUMNS_SUB,
+
+	/**
+	 * Recalculate the totals from the working set
+	 */
+	STRATEGY_WORKING_SET_ADD,
+
+	/**
+	 * Subtract the lines covered by the best attribute, from the working set
+	 */
+	STRATEGY_WORKING_SET_SUB,
+
+	N_STRATEGIES
+} strategy_t;
+
+typedef struct strategy_selector_t
+{
+	/**
+	 * Choose the cheapest strategy from the measured throughput.
+	 * Otherwise the strategy is fixed by the command line options
+	 */
+	bool use_cost_model;
+
+	/**
+	 * Use the column matrix when not using the cost model
+	 */
+	bool column_totals;
+
+	/**
+	 * There's a column matrix, stored or in memory, for the column
+	 * strategies to go through
+	 */
+	bool has_columns;
+
+	/**
+	 * Measured (or default) time, in seconds, to process one word
+	 */
+	double seconds_per_word[N_STRATEGIES];
+
+	/**
+	 * Number of times each strategy was measured
+	 */
+	uint32_t n_samples[N_STRATEGIES];
+
+	/**
+	 * Words processed by each strategy on the current iteration
+	 */
+	uint64_t n_words[N_STRATEGIES];
+
+	/**
+	 * Estimated time of each strategy on the current iteration.
+	 * Negative if the strategy is not available
+	 */
+	double cost[N_STRATEGIES];
+} strategy_selector_t;
+
+#endif // TYPES_STRATEGY_T_H
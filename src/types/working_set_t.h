@@ -0,0 +1,39 @@
+/*
+ ============================================================================
+ Name        : types/working_set_t.h
+ Author      : Eduardo Ribeiro
+ Description : Datatype representing a compact copy of the uncovered lines
+ ============================================================================
+ */
+
+#ifndef TYPES_WORKING_SET_T_H
+#define TYPES_WORKING_SET_T_H
+
+#include "types/word_t.h"
+
+#include <stdint.h>
+
+typedef struct working_set_t
+{
+	/**
+	 * Number of lines in the working set
+	 */
+	uint64_t n_lines;
+
+	/**
+	 * Number of uncovered lines when the working set was last compacted
+	 */
+	uint64_t n_uncovered_lines;
+
+	/**
+	 * Index of each line in the disjoint matrix (relative to first_line)
+	 */
+	uint64_t* line_index;
+
+	/**
+	 * Line data, n_lines * n_words_in_a_line words
+	 */
+	word_t* lines;
+} working_set_t;
+
+#endif // TYPES_WORKING_SET_T_H
@@ -11,6 +11,11 @@
 
 #include <stdint.h>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define TRANSPOSE64_X86
+#include <immintrin.h>
+#endif
+
 word_t set_bits(const word_t destination, const word_t source, const uint8_t at,
 				const uint8_t numbits)
 {
@@ -49,7 +54,7 @@ word_t get_bits(const word_t source, const uint8_t at, const uint8_t numbits)
  * https://stackoverflow.com/questions/41778362/
  * how-to-efficiently-transpose-a-2d-bit-matrix
  */
-void transpose64(uint64_t a[64])
+static void transpose64_scalar(uint64_t a[64])
 {
 	int j, k;
 	uint64_t m, t;
@@ -64,3 +69,180 @@ void transpose64(uint64_t a[64])
 		}
 	}
 }
+
+#ifdef TRANSPOSE64_X86
+
+/**
+ * Same swaps as the scalar version, with 4 lines in each register.
+ * When the lines to swap are in different registers the swaps are done
+ * between registers, otherwise the register is swapped with a permutation
+ * of itself, keeping only the swaps for its first lines
+ */
+__attribute__((target("avx2"))) static void transpose64_avx2(uint64_t a[64])
+{
+	__m256i r[16];
+
+	for (int i = 0; i < 16; i++)
+	{
+		r[i] = _mm256_loadu_si256((const __m256i*) (a + i * 4));
+	}
+
+	uint64_t m = 0x00000000FFFFFFFF;
+	int j	   = 32;
+
+	for (; j >= 4; j >>= 1, m ^= m << j)
+	{
+		__m256i mask  = _mm256_set1_epi64x(m);
+		__m128i shift = _mm_cvtsi32_si128(j);
+
+		// Lines k and k + j are j / 4 registers apart
+		for (int i = 0; i < 16; i++)
+		{
+			if (i & (j / 4))
+			{
+				continue;
+			}
+
+			__m256i t = _mm256_and_si256(
+				_mm256_xor_si256(r[i], _mm256_srl_epi64(r[i + j / 4], shift)),
+				mask);
+			r[i]		 = _mm256_xor_si256(r[i], t);
+			r[i + j / 4] = _mm256_xor_si256(r[i + j / 4],
+											_mm256_sll_epi64(t, shift));
+		}
+	}
+
+	// Lines k and k + 2, and then k + 1, are in the same register
+	__m256i mask2 = _mm256_set_epi64x(0, 0, m, m);
+
+	m ^= m << 1;
+	__m256i mask1 = _mm256_set_epi64x(0, m, 0, m);
+
+	for (int i = 0; i < 16; i++)
+	{
+		__m256i swap = _mm256_permute4x64_epi64(r[i], _MM_SHUFFLE(1, 0, 3, 2));
+		__m256i t	 = _mm256_and_si256(
+			_mm256_xor_si256(r[i], _mm256_srli_epi64(swap, 2)), mask2);
+
+		swap = _mm256_permute4x64_epi64(_mm256_slli_epi64(t, 2),
+										_MM_SHUFFLE(1, 0, 3, 2));
+		r[i] = _mm256_xor_si256(r[i], _mm256_xor_si256(t, swap));
+
+		swap = _mm256_permute4x64_epi64(r[i], _MM_SHUFFLE(2, 3, 0, 1));
+		t	 = _mm256_and_si256(
+			_mm256_xor_si256(r[i], _mm256_srli_epi64(swap, 1)), mask1);
+
+		swap = _mm256_permute4x64_epi64(_mm256_slli_epi64(t, 1),
+										_MM_SHUFFLE(2, 3, 0, 1));
+		r[i] = _mm256_xor_si256(r[i], _mm256_xor_si256(t, swap));
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		_mm256_storeu_si256((__m256i*) (a + i * 4), r[i]);
+	}
+}
+
+/**
+ * Same as the AVX2 version, with 8 lines in each register
+ */
+__attribute__((target("avx512f"))) static void
+transpose64_avx512(uint64_t a[64])
+{
+	__m512i r[8];
+
+	for (int i = 0; i < 8; i++)
+	{
+		r[i] = _mm512_loadu_si512((const void*) (a + i * 8));
+	}
+
+	uint64_t m = 0x00000000FFFFFFFF;
+	int j	   = 32;
+
+	for (; j >= 8; j >>= 1, m ^= m << j)
+	{
+		__m512i mask  = _mm512_set1_epi64(m);
+		__m128i shift = _mm_cvtsi32_si128(j);
+
+		// Lines k and k + j are j / 8 registers apart
+		for (int i = 0; i < 8; i++)
+		{
+			if (i & (j / 8))
+			{
+				continue;
+			}
+
+			__m512i t = _mm512_and_si512(
+				_mm512_xor_si512(r[i], _mm512_srl_epi64(r[i + j / 8], shift)),
+				mask);
+			r[i]		 = _mm512_xor_si512(r[i], t);
+			r[i + j / 8] = _mm512_xor_si512(r[i + j / 8],
+											_mm512_sll_epi64(t, shift));
+		}
+	}
+
+	// Lines k and k + j are in the same register
+	for (; j > 0; j >>= 1, m ^= m << j)
+	{
+		__m128i shift = _mm_cvtsi32_si128(j);
+
+		// Swap each line with the one j lines away
+		__m512i swap = _mm512_set_epi64(7 ^ j, 6 ^ j, 5 ^ j, 4 ^ j, 3 ^ j,
+										2 ^ j, 1 ^ j, 0 ^ j);
+
+		// Only the first line of each pair
+		__mmask8 first = j == 4 ? 0x0F : j == 2 ? 0x33 : 0x55;
+
+		__m512i mask = _mm512_maskz_mov_epi64(first, _mm512_set1_epi64(m));
+
+		for (int i = 0; i < 8; i++)
+		{
+			__m512i t = _mm512_and_si512(
+				_mm512_xor_si512(
+					r[i], _mm512_srl_epi64(
+							  _mm512_permutexvar_epi64(swap, r[i]), shift)),
+				mask);
+			r[i] = _mm512_xor_si512(
+				r[i], _mm512_xor_si512(
+						  t, _mm512_permutexvar_epi64(
+								 swap, _mm512_sll_epi64(t, shift))));
+		}
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		_mm512_storeu_si512((void*) (a + i * 8), r[i]);
+	}
+}
+
+#endif
+
+/**
+ * Transpose kernel for this CPU
+ */
+static void (*transpose64_kernel)(uint64_t a[64]) = transpose64_scalar;
+
+#ifdef TRANSPOSE64_X86
+/**
+ * Chooses the transpose kernel when the program starts, so it's set before
+ * any thread uses it
+ */
+__attribute__((constructor)) static void init_transpose64(void)
+{
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f"))
+	{
+		transpose64_kernel = transpose64_avx512;
+	}
+	else if (__builtin_cpu_supports("avx2"))
+	{
+		transpose64_kernel = transpose64_avx2;
+	}
+}
+#endif
+
+void transpose64(uint64_t a[64])
+{
+	transpose64_kernel(a);
+}
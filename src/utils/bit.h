@@ -120,6 +120,7 @@ word_t get_bits(const word_t source, const uint8_t at, const uint8_t numbits);
 
 /**
  * Transposes a 64x64 bit matrix
+ * Uses the AVX-512 or AVX2 kernel if the CPU supports them
  */
 void transpose64(uint64_t a[64]);
 
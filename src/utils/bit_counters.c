@@ -0,0 +1,235 @@
+/*
+ ============================================================================
+ Name        : utils/bit_counters.c
+ Author      : Eduardo Ribeiro
+ Description : Bit-sliced vertical counters to count the set bits of many
+			   lines for every bit position
+ ============================================================================
+ */
+
+#include "utils/bit_counters.h"
+
+#include "types/bit_counters_t.h"
+#include "types/oknok_t.h"
+#include "types/word_t.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Carry-save adder: adds a, b and c and stores the carry in h and the sum
+ * in l, for all the bits of the words at the same time
+ */
+#define CSA(h, l, a, b, c)                                                     \
+	do                                                                         \
+	{                                                                          \
+		word_t a_ = (a);                                                       \
+		word_t b_ = (b);                                                       \
+		word_t c_ = (c);                                                       \
+		word_t u_ = a_ ^ b_;                                                   \
+		(h)		  = (a_ & b_) | (u_ & c_);                                     \
+		(l)		  = u_ ^ c_;                                                   \
+	} while (0)
+
+oknok_t init_bit_counters(bit_counters_t* counters, const uint32_t n_words,
+						  uint64_t* totals, const bool subtract)
+{
+	counters->n_words	= n_words;
+	counters->n_groups	= 0;
+	counters->n_pending = 0;
+	counters->totals	= totals;
+	counters->subtract	= subtract;
+
+	counters->ones	 = (word_t*) calloc(n_words, sizeof(word_t));
+	counters->twos	 = (word_t*) calloc(n_words, sizeof(word_t));
+	counters->fours	 = (word_t*) calloc(n_words, sizeof(word_t));
+	counters->zeros	 = (word_t*) calloc(n_words, sizeof(word_t));
+	counters->carry	 = (word_t*) calloc(n_words, sizeof(word_t));
+	counters->planes = (word_t*) calloc((uint64_t) BIT_COUNTERS_PLANES * n_words,
+										sizeof(word_t));
+
+	assert(counters->ones != NULL && counters->twos != NULL
+		   && counters->fours != NULL && counters->zeros != NULL
+		   && counters->carry != NULL && counters->planes != NULL);
+
+	return OK;
+}
+
+/**
+ * Adds the totals stored in the counters to the totals array and resets
+ * the counters
+ */
+static void update_totals(bit_counters_t* counters)
+{
+	uint32_t c_attribute = 0;
+
+	for (uint32_t w = 0; w < counters->n_words; w++)
+	{
+		for (int8_t bit = WORD_BITS - 1; bit >= 0; bit--, c_attribute++)
+		{
+			uint32_t total = ((counters->ones[w] >> bit) & 1)
+				+ (((counters->twos[w] >> bit) & 1) << 1)
+				+ (((counters->fours[w] >> bit) & 1) << 2);
+
+			for (uint8_t p = 0; p < BIT_COUNTERS_PLANES; p++)
+			{
+				word_t plane = counters->planes[p * counters->n_words + w];
+				total += ((plane >> bit) & 1) << (p + 3);
+			}
+
+			if (counters->subtract)
+			{
+				counters->totals[c_attribute] -= total;
+			}
+			else
+			{
+				counters->totals[c_attribute] += total;
+			}
+		}
+	}
+
+	memset(counters->ones, 0, counters->n_words * sizeof(word_t));
+	memset(counters->twos, 0, counters->n_words * sizeof(word_t));
+	memset(counters->fours, 0, counters->n_words * sizeof(word_t));
+	memset(counters->planes, 0,
+		   (uint64_t) BIT_COUNTERS_PLANES * counters->n_words * sizeof(word_t));
+
+	counters->n_groups = 0;
+}
+
+/**
+ * Adds 8 lines to the carry-save accumulators, storing the eights in carry.
+ * Every word is independent of the others, so the loop vectorizes
+ */
+static void add_lines_csa(const uint32_t n_words, const word_t* restrict l0,
+						  const word_t* restrict l1, const word_t* restrict l2,
+						  const word_t* restrict l3, const word_t* restrict l4,
+						  const word_t* restrict l5, const word_t* restrict l6,
+						  const word_t* restrict l7, word_t* restrict ones,
+						  word_t* restrict twos, word_t* restrict fours,
+						  word_t* restrict carry)
+{
+	for (uint32_t w = 0; w < n_words; w++)
+	{
+		word_t o = ones[w];
+		word_t t = twos[w];
+		word_t f = fours[w];
+
+		word_t twos_a, twos_b, fours_a, fours_b;
+
+		CSA(twos_a, o, o, l0[w], l1[w]);
+		CSA(twos_b, o, o, l2[w], l3[w]);
+		CSA(fours_a, t, t, twos_a, twos_b);
+		CSA(twos_a, o, o, l4[w], l5[w]);
+		CSA(twos_b, o, o, l6[w], l7[w]);
+		CSA(fours_b, t, t, twos_a, twos_b);
+		CSA(carry[w], f, f, fours_a, fours_b);
+
+		ones[w]	 = o;
+		twos[w]	 = t;
+		fours[w] = f;
+	}
+}
+
+/**
+ * Adds carry to one bit plane, leaving the carry out in carry
+ */
+static void add_carry(const uint32_t n_words, word_t* restrict plane,
+					  word_t* restrict carry)
+{
+	for (uint32_t w = 0; w < n_words; w++)
+	{
+		word_t v = plane[w];
+		plane[w] = v ^ carry[w];
+		carry[w] = v & carry[w];
+	}
+}
+
+/**
+ * Counts a full group of lines
+ */
+static void add_group(bit_counters_t* counters)
+{
+	const word_t** l = counters->pending;
+
+	add_lines_csa(counters->n_words, l[0], l[1], l[2], l[3], l[4], l[5], l[6],
+				  l[7], counters->ones, counters->twos, counters->fours,
+				  counters->carry);
+
+	// Ripple the eights through the bit planes
+	for (uint8_t p = 0; p < BIT_COUNTERS_PLANES; p++)
+	{
+		add_carry(counters->n_words,
+				  counters->planes + p * counters->n_words, counters->carry);
+	}
+
+	counters->n_pending = 0;
+	counters->n_groups++;
+
+	if (counters->n_groups == (1U << BIT_COUNTERS_PLANES) - 1)
+	{
+		// The planes are full
+		update_totals(counters);
+	}
+}
+
+void bit_counters_add_line(bit_counters_t* counters, const word_t* line)
+{
+	counters->pending[counters->n_pending++] = line;
+
+	if (counters->n_pending == BIT_COUNTERS_GROUP)
+	{
+		add_group(counters);
+	}
+}
+
+void bit_counters_sync(bit_counters_t* counters)
+{
+	if (counters->n_pending == 0)
+	{
+		return;
+	}
+
+	// Complete the group with zeros
+	while (counters->n_pending < BIT_COUNTERS_GROUP)
+	{
+		counters->pending[counters->n_pending++] = counters->zeros;
+	}
+
+	add_group(counters);
+}
+
+void bit_counters_flush(bit_counters_t* counters)
+{
+	bit_counters_sync(counters);
+
+	if (counters->n_groups > 0)
+	{
+		update_totals(counters);
+	}
+}
+
+void free_bit_counters(bit_counters_t* counters)
+{
+	free(counters->ones);
+	free(counters->twos);
+	free(counters->fours);
+	free(counters->zeros);
+	free(counters->carry);
+	free(counters->planes);
+
+	counters->ones	 = NULL;
+	counters->twos	 = NULL;
+	counters->fours	 = NULL;
+	counters->zeros	 = NULL;
+	counters->carry	 = NULL;
+	counters->planes = NULL;
+
+	counters->n_words	= 0;
+	counters->n_groups	= 0;
+	counters->n_pending = 0;
+	counters->totals	= NULL;
+}
@@ -0,0 +1,50 @@
+/*
+ ============================================================================
+ Name        : utils/bit_counters.h
+ Author      : Eduardo Ribeiro
+ Description : Bit-sliced vertical counters to count the set bits of many
+			   lines for every bit position
+ ============================================================================
+ */
+
+#ifndef UTILS_BIT_COUNTERS_H
+#define UTILS_BIT_COUNTERS_H
+
+#include "types/bit_counters_t.h"
+#include "types/oknok_t.h"
+#include "types/word_t.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Sets up the counters for lines of n_words.
+ * On flush the counts are added to (or subtracted from) totals, which must
+ * have n_words * WORD_BITS elements
+ */
+oknok_t init_bit_counters(bit_counters_t* counters, const uint32_t n_words,
+						  uint64_t* totals, const bool subtract);
+
+/**
+ * Counts the bits of this line.
+ * The line is only read when a group is complete, so it must remain valid
+ * until then, or until bit_counters_sync is called
+ */
+void bit_counters_add_line(bit_counters_t* counters, const word_t* line);
+
+/**
+ * Counts the lines that are waiting to complete a group
+ */
+void bit_counters_sync(bit_counters_t* counters);
+
+/**
+ * Counts the pending lines and updates the totals
+ */
+void bit_counters_flush(bit_counters_t* counters);
+
+/**
+ * Frees the allocated resources
+ */
+void free_bit_counters(bit_counters_t* counters);
+
+#endif // UTILS_BIT_COUNTERS_H
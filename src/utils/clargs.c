@@ -10,18 +10,52 @@
 
 #include "utils/cargs.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
+/**
+ * Converts the option value to an unsigned integer.
+ * Returns 0 if there's no value
+ */
+static uint32_t parse_uint32(const char* value)
+{
+	if (value == NULL)
+	{
+		return 0;
+	}
+
+	return (uint32_t) strtoul(value, NULL, 10);
+}
+
 int read_args(int argc, char** argv, clargs_t* args)
 {
 	char identifier;
 	const char* value;
 	cag_option_context context;
 
-	args->datasetname = NULL;
-	args->filename	  = NULL;
+	args->datasetname	   = NULL;
+	args->filename		   = NULL;
+	args->block_size	   = DEFAULT_BLOCK_SIZE;
+	args->write_block_size = DEFAULT_WRITE_BLOCK_SIZE;
+	args->tile_memory	   = DEFAULT_TILE_MEMORY;
+	args->write_blocks	   = DEFAULT_WRITE_BLOCKS;
+	args->blocked_order	   = false;
+	args->chunked		   = false;
+	args->deflate_level	   = 0;
+	args->chunk_cache	   = 0;
+	args->single_copy	   = false;
+	args->sparse_columns   = false;
+	args->virtual_matrix   = false;
+	args->memory_budget	   = 0;
+	args->column_totals	   = false;
+	args->lazy			   = false;
+	args->auto_strategy	   = false;
+	args->partition		   = false;
+	args->n_threads		   = 0;
+	args->working_set	   = 0;
 
 	/**
 	 * This is the main configuration of all options available.
@@ -38,6 +72,145 @@ int read_args(int argc, char** argv, clargs_t* args)
 							   .value_name	   = "dataset",
 							   .description	   = "Dataset identifier" },
 
+							 { .identifier	   = 'b',
+							   .access_letters = "b",
+							   .access_name	   = "block-size",
+							   .value_name	   = "lines",
+							   .description
+							   = "Number of matrix lines read at a time" },
+
+							 { .identifier	   = 'o',
+							   .access_letters = "o",
+							   .access_name	   = "write-block-size",
+							   .value_name	   = "lines",
+							   .description
+							   = "Number of matrix lines written at a time" },
+
+							 { .identifier	   = 's',
+							   .access_letters = "s",
+							   .access_name	   = "tile-memory",
+							   .value_name	   = "MB",
+							   .description
+							   = "Memory for the matrix lines being built and "
+								 "written" },
+
+							 { .identifier	   = 'q',
+							   .access_letters = "q",
+							   .access_name	   = "write-blocks",
+							   .value_name	   = "n",
+							   .description
+							   = "Number of matrix blocks built or written at "
+								 "once" },
+
+							 { .identifier	   = 'r',
+							   .access_letters = "r",
+							   .access_name	   = "blocked-order",
+							   .value_name	   = NULL,
+							   .description
+							   = "Generate the matrix lines in tiles of "
+								 "observations of each pair of classes" },
+
+							 { .identifier	   = 'k',
+							   .access_letters = "k",
+							   .access_name	   = "chunked",
+							   .value_name	   = NULL,
+							   .description
+							   = "Store the disjoint matrix in chunks shaped "
+								 "after the block sizes" },
+
+							 { .identifier	   = 'z',
+							   .access_letters = "z",
+							   .access_name	   = "deflate",
+							   .value_name	   = "level",
+							   .description
+							   = "Compress the chunks with shuffle and deflate "
+								 "(1-9)" },
+
+							 { .identifier	   = 'e',
+							   .access_letters = "e",
+							   .access_name	   = "chunk-cache",
+							   .value_name	   = "MB",
+							   .description
+							   = "Chunk cache of each matrix dataset, by "
+								 "default two chunks" },
+
+							 { .identifier	   = 'u',
+							   .access_letters = "u",
+							   .access_name	   = "single-copy",
+							   .value_name	   = NULL,
+							   .description
+							   = "Store the disjoint matrix only by columns" },
+
+							 { .identifier	   = 'x',
+							   .access_letters = "x",
+							   .access_name	   = "sparse-columns",
+							   .value_name	   = NULL,
+							   .description
+							   = "Also store the columns as the lines they "
+								 "cover" },
+
+							 { .identifier	   = 'v',
+							   .access_letters = "v",
+							   .access_name	   = "virtual",
+							   .value_name	   = NULL,
+							   .description
+							   = "Generate the disjoint matrix from the "
+								 "observations instead of storing it" },
+
+							 { .identifier	   = 'm',
+							   .access_letters = "m",
+							   .access_name	   = "memory-budget",
+							   .value_name	   = "MB",
+							   .description
+							   = "Memory available to keep the disjoint matrix "
+								 "in memory" },
+
+							 { .identifier	   = 'c',
+							   .access_letters = "c",
+							   .access_name	   = "column-totals",
+							   .value_name	   = NULL,
+							   .description
+							   = "Calculate the attribute totals from the "
+								 "column dataset" },
+
+							 { .identifier	   = 'l',
+							   .access_letters = "l",
+							   .access_name	   = "lazy",
+							   .value_name	   = NULL,
+							   .description
+							   = "Lazy greedy selection: only refresh the "
+								 "totals of the best candidates" },
+
+							 { .identifier	   = 'a',
+							   .access_letters = "a",
+							   .access_name	   = "auto-strategy",
+							   .value_name	   = NULL,
+							   .description
+							   = "Choose how to update the attribute totals "
+								 "from their measured cost" },
+
+							 { .identifier	   = 'p',
+							   .access_letters = "p",
+							   .access_name	   = "partition",
+							   .value_name	   = NULL,
+							   .description
+							   = "Apply the set cover without building the "
+								 "disjoint matrix" },
+
+							 { .identifier	   = 't',
+							   .access_letters = "t",
+							   .access_name	   = "threads",
+							   .value_name	   = "n",
+							   .description	   = "Number of threads to use" },
+
+							 { .identifier	   = 'w',
+							   .access_letters = "w",
+							   .access_name	   = "working-set",
+							   .value_name	   = "percent",
+							   .description
+							   = "Keep the uncovered lines in memory once "
+								 "they drop below this percentage" },
+
 							 { .identifier	   = 'h',
 							   .access_letters = "h",
 							   .access_name	   = "help",
@@ -62,6 +235,71 @@ int read_args(int argc, char** argv, clargs_t* args)
 				value			  = cag_option_get_value(&context);
 				args->datasetname = value;
 				break;
+			case 'b':
+				value			 = cag_option_get_value(&context);
+				args->block_size = parse_uint32(value);
+				break;
+			case 'o':
+				value				   = cag_option_get_value(&context);
+				args->write_block_size = parse_uint32(value);
+				break;
+			case 's':
+				value			  = cag_option_get_value(&context);
+				args->tile_memory = parse_uint32(value);
+				break;
+			case 'q':
+				value			   = cag_option_get_value(&context);
+				args->write_blocks = parse_uint32(value);
+				break;
+			case 'r':
+				args->blocked_order = true;
+				break;
+			case 'k':
+				args->chunked = true;
+				break;
+			case 'z':
+				value				= cag_option_get_value(&context);
+				args->deflate_level = parse_uint32(value);
+				args->chunked		= true;
+				break;
+			case 'e':
+				value			  = cag_option_get_value(&context);
+				args->chunk_cache = parse_uint32(value);
+				break;
+			case 'u':
+				args->single_copy = true;
+				args->chunked	  = true;
+				break;
+			case 'x':
+				args->sparse_columns = true;
+				break;
+			case 'v':
+				args->virtual_matrix = true;
+				break;
+			case 'm':
+				value				= cag_option_get_value(&context);
+				args->memory_budget = parse_uint32(value);
+				break;
+			case 'c':
+				args->column_totals = true;
+				break;
+			case 'l':
+				args->lazy = true;
+				break;
+			case 'a':
+				args->auto_strategy = true;
+				break;
+			case 'p':
+				args->partition = true;
+				break;
+			case 't':
+				value			= cag_option_get_value(&context);
+				args->n_threads = parse_uint32(value);
+				break;
+			case 'w':
+				value			  = cag_option_get_value(&context);
+				args->working_set = parse_uint32(value);
+				break;
 			case 'h':
 				printf("Usage: %s [OPTION]...\n", argv[0]);
 				cag_option_print(options, CAG_ARRAY_SIZE(options), stdout);
@@ -69,7 +307,9 @@ int read_args(int argc, char** argv, clargs_t* args)
 		}
 	}
 
-	if (args->filename == NULL || args->datasetname == NULL)
+	if (args->filename == NULL || args->datasetname == NULL
+		|| args->block_size == 0 || args->write_block_size == 0
+		|| args->write_blocks == 0 || args->deflate_level > 9)
 	{
 		printf("Usage: %s [OPTION]...\n", argv[0]);
 		cag_option_print(options, CAG_ARRAY_SIZE(options), stdout);
@@ -9,12 +9,35 @@
 #ifndef CL_ARGS_H
 #define CL_ARGS_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /**
  * Do not edit
  */
 #define READ_CL_ARGS_OK	 0
 #define READ_CL_ARGS_NOK 1
 
+/**
+ * Default number of disjoint matrix lines read from the dataset at a time
+ */
+#define DEFAULT_BLOCK_SIZE 4096
+
+/**
+ * Default number of disjoint matrix lines written to the dataset at a time
+ */
+#define DEFAULT_WRITE_BLOCK_SIZE 16384
+
+/**
+ * Default memory (in MB) for the blocks being built and written
+ */
+#define DEFAULT_TILE_MEMORY 512
+
+/**
+ * Default number of disjoint matrix blocks being built or written at once
+ */
+#define DEFAULT_WRITE_BLOCKS 2
+
 /**
  * Structure to store command line options
  */
@@ -29,6 +52,111 @@ typedef struct clargs_t
 	 * The dataset identifier
 	 */
 	const char* datasetname;
+
+	/**
+	 * Number of disjoint matrix lines read from the dataset at a time
+	 */
+	uint32_t block_size;
+
+	/**
+	 * Number of disjoint matrix lines built and written to the dataset at a
+	 * time
+	 */
+	uint32_t write_block_size;
+
+	/**
+	 * Memory (in MB) for the blocks of the disjoint matrix being built and
+	 * written, which may make them smaller than write_block_size.
+	 * 0 means there's no limit
+	 */
+	uint32_t tile_memory;
+
+	/**
+	 * Number of disjoint matrix blocks being built or written at once, so
+	 * the next blocks are built while the previous ones are written
+	 */
+	uint32_t write_blocks;
+
+	/**
+	 * Generate the disjoint matrix lines in tiles of observations of each
+	 * pair of classes that fit in the cache
+	 */
+	bool blocked_order;
+
+	/**
+	 * Store the disjoint matrix in chunks: blocks of block_size lines for
+	 * the line dataset, one attribute of the lines built at a time for the
+	 * column dataset
+	 */
+	bool chunked;
+
+	/**
+	 * Deflate level of the chunks, 0 means they aren't compressed.
+	 * Implies chunked
+	 */
+	uint32_t deflate_level;
+
+	/**
+	 * Size (in MB) of the chunk cache of each disjoint matrix dataset.
+	 * 0 means room for two chunks
+	 */
+	uint32_t chunk_cache;
+
+	/**
+	 * Store the disjoint matrix only by columns, the lines are read from
+	 * its tiles. Implies chunked
+	 */
+	bool single_copy;
+
+	/**
+	 * Also store the disjoint matrix columns as the lines they cover, which
+	 * the set cover reads instead of the column dataset
+	 */
+	bool sparse_columns;
+
+	/**
+	 * Don't store the disjoint matrix, generate its lines and columns from
+	 * the observations, which are stored instead
+	 */
+	bool virtual_matrix;
+
+	/**
+	 * Memory (in MB) available to keep the disjoint matrix in memory.
+	 * 0 means the matrix is always read from the dataset
+	 */
+	uint32_t memory_budget;
+
+	/**
+	 * Calculate the attribute totals from the column dataset
+	 */
+	bool column_totals;
+
+	/**
+	 * Use the lazy greedy attribute selection
+	 */
+	bool lazy;
+
+	/**
+	 * Choose how to update the attribute totals from their measured cost
+	 */
+	bool auto_strategy;
+
+	/**
+	 * Apply the set cover to the partition of the observations instead of
+	 * the disjoint matrix, which is never built
+	 */
+	bool partition;
+
+	/**
+	 * Number of threads to use. 0 means the OpenMP default
+	 */
+	uint32_t n_threads;
+
+	/**
+	 * Percentage of uncovered lines below which the uncovered lines are
+	 * copied to a compact working set in memory. 0 disables it
+	 */
+	uint32_t working_set;
 } clargs_t;
 
 /**
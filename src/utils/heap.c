@@ -0,0 +1,118 @@
+/*
+ ============================================================================
+ Name        : utils/heap.c
+ Author      : Eduardo Ribeiro
+ Description : Max-heap of indexed values
+ ============================================================================
+ */
+
+#include "utils/heap.h"
+
+#include "types/heap_t.h"
+#include "types/oknok_t.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Checks if entry a must come before entry b
+ */
+static inline bool comes_first(const heap_entry_t* a, const heap_entry_t* b)
+{
+	return a->value > b->value || (a->value == b->value && a->index < b->index);
+}
+
+/**
+ * Moves the entry at position i down until the heap order is restored
+ */
+static void sift_down(heap_t* heap, uint32_t i)
+{
+	heap_entry_t* e = heap->entries;
+
+	while (true)
+	{
+		uint32_t first = i;
+		uint32_t left  = 2 * i + 1;
+		uint32_t right = 2 * i + 2;
+
+		if (left < heap->n_entries && comes_first(&e[left], &e[first]))
+		{
+			first = left;
+		}
+
+		if (right < heap->n_entries && comes_first(&e[right], &e[first]))
+		{
+			first = right;
+		}
+
+		if (first == i)
+		{
+			return;
+		}
+
+		heap_entry_t t = e[i];
+		e[i]		   = e[first];
+		e[first]	   = t;
+
+		i = first;
+	}
+}
+
+oknok_t init_heap(heap_t* heap, const uint64_t* values,
+				  const uint32_t n_values)
+{
+	heap->n_entries = n_values;
+	heap->entries	= (heap_entry_t*) malloc(n_values * sizeof(heap_entry_t));
+	assert(heap->entries != NULL);
+
+	for (uint32_t i = 0; i < n_values; i++)
+	{
+		heap->entries[i].index = i;
+		heap->entries[i].value = values[i];
+	}
+
+	// Heapify
+	for (uint32_t i = n_values / 2; i > 0; i--)
+	{
+		sift_down(heap, i - 1);
+	}
+
+	return OK;
+}
+
+heap_entry_t heap_top(const heap_t* heap)
+{
+	assert(heap->n_entries > 0);
+
+	return heap->entries[0];
+}
+
+void heap_pop(heap_t* heap)
+{
+	assert(heap->n_entries > 0);
+
+	heap->n_entries--;
+	heap->entries[0] = heap->entries[heap->n_entries];
+
+	sift_down(heap, 0);
+}
+
+void heap_decrease_top(heap_t* heap, const uint64_t value)
+{
+	assert(heap->n_entries > 0);
+	assert(value <= heap->entries[0].value);
+
+	heap->entries[0].value = value;
+
+	sift_down(heap, 0);
+}
+
+void free_heap(heap_t* heap)
+{
+	free(heap->entries);
+
+	heap->entries	= NULL;
+	heap->n_entries = 0;
+}
@@ -0,0 +1,46 @@
+/*
+ ============================================================================
+ Name        : utils/heap.h
+ Author      : Eduardo Ribeiro
+ Description : Max-heap of indexed values.
+			   Higher values come first; on ties the lowest index comes
+			   first, just like a linear search for the first maximum
+ ============================================================================
+ */
+
+#ifndef UTILS_HEAP_H
+#define UTILS_HEAP_H
+
+#include "types/heap_t.h"
+#include "types/oknok_t.h"
+
+#include <stdint.h>
+
+/**
+ * Builds a heap with the n_values values, indexed by their position
+ */
+oknok_t init_heap(heap_t* heap, const uint64_t* values,
+				  const uint32_t n_values);
+
+/**
+ * Returns the entry at the top of the heap
+ */
+heap_entry_t heap_top(const heap_t* heap);
+
+/**
+ * Removes the entry at the top of the heap
+ */
+void heap_pop(heap_t* heap);
+
+/**
+ * Changes the value of the entry at the top of the heap.
+ * The new value can't be higher than the old one
+ */
+void heap_decrease_top(heap_t* heap, const uint64_t value);
+
+/**
+ * Frees the allocated resources
+ */
+void free_heap(heap_t* heap);
+
+#endif // UTILS_HEAP_H
@@ -0,0 +1,255 @@
+/*
+ ============================================================================
+ Name        : working_set.c
+ Author      : Eduardo Ribeiro
+ Description : Compact copy of the uncovered lines of the disjoint matrix.
+			   Once most lines are covered, the attribute totals are
+			   updated from this small, dense set instead of scanning the
+			   whole matrix
+ ============================================================================
+ */
+
+#include "working_set.h"
+
+#include "dataset_hdf5.h"
+#include "set_cover.h"
+#include "types/bit_counters_t.h"
+#include "types/cover_t.h"
+#include "types/dataset_hdf5_t.h"
+#include "types/oknok_t.h"
+#include "types/word_t.h"
+#include "types/working_set_t.h"
+#include "utils/bit.h"
+#include "utils/bit_counters.h"
+
+#include <assert.h>
+#include <omp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Returns true if line l is still uncovered and, if column isn't NULL,
+ * covered by column
+ */
+static inline bool is_line_to_process(const cover_t* cover,
+									  const word_t* column, const uint64_t l)
+{
+	uint64_t w	= l / WORD_BITS;
+	uint8_t bit = WORD_BITS - (l % WORD_BITS) - 1;
+
+	word_t lines = ~cover->covered_lines[w];
+	if (column != NULL)
+	{
+		lines &= column[w];
+	}
+
+	return BIT_CHECK(lines, bit);
+}
+
+/**
+ * Counts the uncovered lines and allocates the working set for them
+ */
+static void alloc_working_set(working_set_t* ws, const cover_t* cover)
+{
+	uint64_t n_lines = 0;
+
+	uint64_t start	  = 0;
+	uint64_t n_run	  = 0;
+	uint64_t cur_line = 0;
+	while ((n_run = get_next_line_run(cover, NULL, cur_line,
+									  cover->n_matrix_lines, &start))
+		   > 0)
+	{
+		n_lines += n_run;
+		cur_line = start + n_run;
+	}
+
+	ws->n_lines			  = n_lines;
+	ws->n_uncovered_lines = cover->n_uncovered_lines;
+
+	ws->line_index = (uint64_t*) malloc(n_lines * sizeof(uint64_t));
+	assert(n_lines == 0 || ws->line_index != NULL);
+
+	ws->lines = (word_t*) malloc((uint64_t) n_lines * cover->n_words_in_a_line
+								 * sizeof(word_t));
+	assert(n_lines == 0 || ws->lines != NULL);
+}
+
+void init_working_set(working_set_t* ws)
+{
+	ws->n_lines			  = 0;
+	ws->n_uncovered_lines = 0;
+	ws->line_index		  = NULL;
+	ws->lines			  = NULL;
+}
+
+oknok_t build_working_set_mem(working_set_t* ws, const cover_t* cover,
+							  const word_t* line_data)
+{
+	free_working_set(ws);
+	alloc_working_set(ws, cover);
+
+	uint64_t n_lines  = 0;
+	uint64_t start	  = 0;
+	uint64_t n_run	  = 0;
+	uint64_t cur_line = 0;
+	while ((n_run = get_next_line_run(cover, NULL, cur_line,
+									  cover->n_matrix_lines, &start))
+		   > 0)
+	{
+		memcpy(ws->lines + (uint64_t) n_lines * cover->n_words_in_a_line,
+			   line_data + (uint64_t) start * cover->n_words_in_a_line,
+			   (uint64_t) n_run * cover->n_words_in_a_line * sizeof(word_t));
+
+		for (uint64_t l = 0; l < n_run; l++)
+		{
+			ws->line_index[n_lines++] = start + l;
+		}
+
+		cur_line = start + n_run;
+	}
+
+	return OK;
+}
+
+oknok_t build_working_set(working_set_t* ws, const cover_t* cover,
+						  const dataset_hdf5_t* line_dataset)
+{
+	free_working_set(ws);
+	alloc_working_set(ws, cover);
+
+	uint64_t n_lines  = 0;
+	uint64_t start	  = 0;
+	uint64_t n_run	  = 0;
+	uint64_t cur_line = 0;
+	while ((n_run = get_next_line_run(cover, NULL, cur_line,
+									  cover->n_matrix_lines, &start))
+		   > 0)
+	{
+		// Each run of uncovered lines is read straight into the working set
+		word_t* lines
+			= ws->lines + (uint64_t) n_lines * cover->n_words_in_a_line;
+
+		hdf5_read_lines(line_dataset, cover->first_line + start,
+						cover->n_words_in_a_line, n_run, lines);
+
+		for (uint64_t l = 0; l < n_run; l++)
+		{
+			ws->line_index[n_lines++] = start + l;
+		}
+
+		cur_line = start + n_run;
+	}
+
+	return OK;
+}
+
+oknok_t compact_working_set(working_set_t* ws, const cover_t* cover)
+{
+	uint64_t n_lines = 0;
+
+	for (uint64_t i = 0; i < ws->n_lines; i++)
+	{
+		if (!is_line_to_process(cover, NULL, ws->line_index[i]))
+		{
+			continue;
+		}
+
+		if (n_lines != i)
+		{
+			ws->line_index[n_lines] = ws->line_index[i];
+			memcpy(ws->lines + (uint64_t) n_lines * cover->n_words_in_a_line,
+				   ws->lines + (uint64_t) i * cover->n_words_in_a_line,
+				   cover->n_words_in_a_line * sizeof(word_t));
+		}
+
+		n_lines++;
+	}
+
+	ws->n_lines			  = n_lines;
+	ws->n_uncovered_lines = cover->n_uncovered_lines;
+
+	return OK;
+}
+
+/**
+ * Adds (or subtracts) the contribution of the working set lines to process
+ * to the attribute totals.
+ * Each thread processes its own share of the working set into private
+ * totals, which are then reduced into the attribute totals
+ */
+static oknok_t update_attribute_totals_ws(cover_t* cover,
+										  const working_set_t* ws,
+										  const word_t* column,
+										  const bool subtract)
+{
+	uint32_t max_threads	= omp_get_max_threads();
+	uint64_t** partial_totals
+		= (uint64_t**) calloc(max_threads, sizeof(uint64_t*));
+	assert(partial_totals != NULL);
+
+#pragma omp parallel num_threads(max_threads)
+	{
+		uint32_t thread_id = omp_get_thread_num();
+		uint32_t n_threads = omp_get_num_threads();
+
+		uint64_t* totals = (uint64_t*) calloc(
+			cover->n_words_in_a_line * WORD_BITS, sizeof(uint64_t));
+		assert(totals != NULL);
+
+		bit_counters_t counters;
+		init_bit_counters(&counters, cover->n_words_in_a_line, totals, false);
+
+#pragma omp for schedule(static)
+		for (uint64_t i = 0; i < ws->n_lines; i++)
+		{
+			if (is_line_to_process(cover, column, ws->line_index[i]))
+			{
+				bit_counters_add_line(
+					&counters,
+					ws->lines + (uint64_t) i * cover->n_words_in_a_line);
+			}
+		}
+
+		bit_counters_flush(&counters);
+		free_bit_counters(&counters);
+
+		partial_totals[thread_id] = totals;
+
+#pragma omp barrier
+
+		reduce_attribute_totals(cover, partial_totals, n_threads, subtract);
+
+		free(totals);
+	}
+
+	free(partial_totals);
+
+	return OK;
+}
+
+oknok_t update_attribute_totals_add_ws(cover_t* cover,
+									   const working_set_t* ws)
+{
+	// Reset totals
+	memset(cover->attribute_totals, 0, cover->n_attributes * sizeof(uint64_t));
+
+	return update_attribute_totals_ws(cover, ws, NULL, false);
+}
+
+oknok_t update_attribute_totals_sub_ws(cover_t* cover,
+									   const working_set_t* ws,
+									   const word_t* column)
+{
+	return update_attribute_totals_ws(cover, ws, column, true);
+}
+
+void free_working_set(working_set_t* ws)
+{
+	free(ws->line_index);
+	free(ws->lines);
+
+	init_working_set(ws);
+}
@@ -0,0 +1,65 @@
+/*
+ ============================================================================
+ Name        : working_set.h
+ Author      : Eduardo Ribeiro
+ Description : Compact copy of the uncovered lines of the disjoint matrix.
+			   Once most lines are covered, the attribute totals are
+			   updated from this small, dense set instead of scanning the
+			   whole matrix
+ ============================================================================
+ */
+
+#ifndef WORKING_SET_H
+#define WORKING_SET_H
+
+#include "types/cover_t.h"
+#include "types/dataset_hdf5_t.h"
+#include "types/oknok_t.h"
+#include "types/word_t.h"
+#include "types/working_set_t.h"
+
+#include <stdint.h>
+
+/**
+ * Initializes (zeroes) the working set
+ */
+void init_working_set(working_set_t* ws);
+
+/**
+ * Copies the uncovered lines from the disjoint matrix stored in memory
+ */
+oknok_t build_working_set_mem(working_set_t* ws, const cover_t* cover,
+							  const word_t* line_data);
+
+/**
+ * Reads the uncovered lines from the line dataset
+ */
+oknok_t build_working_set(working_set_t* ws, const cover_t* cover,
+						  const dataset_hdf5_t* line_dataset);
+
+/**
+ * Removes the lines that are already covered from the working set
+ */
+oknok_t compact_working_set(working_set_t* ws, const cover_t* cover);
+
+/**
+ * Calculates the attribute totals for the uncovered lines, using the
+ * working set
+ */
+oknok_t update_attribute_totals_add_ws(cover_t* cover,
+									   const working_set_t* ws);
+
+/**
+ * Removes the contribution of the lines that are about to be covered by
+ * column from the attribute totals, using the working set
+ */
+oknok_t update_attribute_totals_sub_ws(cover_t* cover,
+									   const working_set_t* ws,
+									   const word_t* column);
+
+/**
+ * Frees the allocated resources
+ */
+void free_working_set(working_set_t* ws);
+
+#endif // WORKING_SET_H
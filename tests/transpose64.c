@@ -0,0 +1,195 @@
+/*
+ ============================================================================
+ Name        : tests/transpose64.c
+ Author      : Eduardo Ribeiro
+ Description : Checks the SIMD 64x64 bit transpose kernels against the
+			   scalar one on random matrices, and with "bench" as argument
+			   prints the transposes per second of each kernel
+ ============================================================================
+ */
+
+// The kernels are static, so they're built in here
+#include "utils/bit.c"
+
+#include <omp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Random matrices checked against the scalar kernel
+ */
+#define TEST_MATRICES 200000
+
+/**
+ * Transposes of each kernel timed in the benchmark
+ */
+#define BENCH_TRANSPOSES 5000000
+
+/**
+ * Kernel to check or time
+ */
+typedef struct kernel_t
+{
+	const char* name;
+	void (*transpose)(uint64_t a[64]);
+	bool supported;
+} kernel_t;
+
+/**
+ * xorshift64, the same matrices on every run
+ */
+static uint64_t next_random(uint64_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/**
+ * Fills the kernels this CPU can run, returns how many there are
+ */
+static uint32_t get_kernels(kernel_t* kernels)
+{
+	uint32_t n_kernels = 0;
+
+	kernels[n_kernels++] = (kernel_t) { "scalar", transpose64_scalar, true };
+
+#ifdef TRANSPOSE64_X86
+	__builtin_cpu_init();
+
+	kernels[n_kernels++] = (kernel_t) { "avx2", transpose64_avx2,
+										__builtin_cpu_supports("avx2") };
+	kernels[n_kernels++] = (kernel_t) { "avx512", transpose64_avx512,
+										__builtin_cpu_supports("avx512f") };
+#endif
+
+	return n_kernels;
+}
+
+/**
+ * Returns the number of matrices the kernel transposes differently from
+ * the scalar kernel
+ */
+static uint64_t check_kernel(const kernel_t* kernel)
+{
+	uint64_t state		= 0x9E3779B97F4A7C15;
+	uint64_t mismatches = 0;
+
+	uint64_t expected[64];
+	uint64_t actual[64];
+
+	for (uint64_t i = 0; i < TEST_MATRICES; i++)
+	{
+		for (uint8_t l = 0; l < 64; l++)
+		{
+			expected[l] = next_random(&state);
+
+			// Some sparse and some full lines too
+			if (i % 3 == 1)
+			{
+				expected[l] &= next_random(&state) & next_random(&state);
+			}
+			else if (i % 3 == 2)
+			{
+				expected[l] |= next_random(&state) | next_random(&state);
+			}
+		}
+
+		memcpy(actual, expected, sizeof(actual));
+
+		transpose64_scalar(expected);
+		kernel->transpose(actual);
+
+		if (memcmp(expected, actual, sizeof(actual)) != 0)
+		{
+			mismatches++;
+		}
+	}
+
+	return mismatches;
+}
+
+/**
+ * Returns the transposes per second of the kernel
+ */
+static double bench_kernel(const kernel_t* kernel)
+{
+	uint64_t state = 0x9E3779B97F4A7C15;
+
+	uint64_t a[64];
+	for (uint8_t l = 0; l < 64; l++)
+	{
+		a[l] = next_random(&state);
+	}
+
+	double start = omp_get_wtime();
+
+	for (uint64_t i = 0; i < BENCH_TRANSPOSES; i++)
+	{
+		kernel->transpose(a);
+	}
+
+	double elapsed = omp_get_wtime() - start;
+
+	// Keep the result, so the transposes aren't optimized away
+	uint64_t checksum = 0;
+	for (uint8_t l = 0; l < 64; l++)
+	{
+		checksum ^= a[l];
+	}
+	if (checksum == 0)
+	{
+		printf("(checksum 0) ");
+	}
+
+	return BENCH_TRANSPOSES / elapsed;
+}
+
+int main(int argc, char** argv)
+{
+	bool bench = argc > 1 && strcmp(argv[1], "bench") == 0;
+
+	kernel_t kernels[3];
+	uint32_t n_kernels = get_kernels(kernels);
+
+	int failed = 0;
+
+	for (uint32_t k = 0; k < n_kernels; k++)
+	{
+		if (!kernels[k].supported)
+		{
+			printf("%-8s not supported by this CPU, skipped\n",
+				   kernels[k].name);
+			continue;
+		}
+
+		if (bench)
+		{
+			printf("%-8s %6.2fM transposes/s\n", kernels[k].name,
+				   bench_kernel(&kernels[k]) / 1e6);
+			continue;
+		}
+
+		// The scalar kernel is the reference
+		if (kernels[k].transpose == transpose64_scalar)
+		{
+			continue;
+		}
+
+		uint64_t mismatches = check_kernel(&kernels[k]);
+
+		printf("%-8s %s: %lu mismatches in %d matrices\n", kernels[k].name,
+			   mismatches == 0 ? "OK" : "FAILED", (unsigned long) mismatches,
+			   TEST_MATRICES);
+
+		if (mismatches > 0)
+		{
+			failed = 1;
+		}
+	}
+
+	return failed;
+}